@@ -3,6 +3,9 @@
 #include<time.h>
 #include<math.h>
 #include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 
 // CONSTANTS
@@ -17,7 +20,8 @@
 // 2^n=frame size; n = 2, 2 bits required to uniquely represent a frame of 4 bytes
 #define FRAME_SIZE 16
 // e.g., in a 1024 byte physical memory, the addresses will be m bits (where m=10) since 2^10=1024. 10 bits are required to uniquely represent addresses in a 1024-byte physical memory. So an address for each byte. That's how a byte-addressable memory system works.
-#define PHYSICAL_MEMORY_SIZE (FRAME_SIZE * 64) // 1024 bytes; 64 frames
+#define MEMORY_PRESSURE 0 // 1 runs the workload in 12 frames, so that pages are evicted and swapped back in (see the SWAP STATS for where each swapped out page was loaded from: the pool, the write batch or the swap file). With 0, every process fits in memory and nothing is ever evicted.
+#define PHYSICAL_MEMORY_SIZE (FRAME_SIZE * (MEMORY_PRESSURE ? 12 : 64)) // 1024 bytes; 64 frames
 #define NO_OF_FRAMES (PHYSICAL_MEMORY_SIZE/FRAME_SIZE)
 // for a physical memory of 1024 bytes and frames of 16 bytes,
 // m = 10, n = 4
@@ -44,17 +48,263 @@
 #define OUTER_PAGE_TABLE_SIZE (NO_OF_PAGES/NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE) // 256/4 = 64
 // OUTER PAGE TABLE 64x4 (64 blocks/pages, 4 page entries within each block)
 
+#define TLB_SIZE 4 // number of entries in the fully associative TLB
+#define TLB_COALESCING_MAX_PAGES 8 // most pages one TLB entry may cover when consecutive pages map on to consecutive frames (8 or 16). 1 turns coalescing off.
+
+// Range translation for regions that are contiguous both in virtual and physical memory
+#define RANGE_TRANSLATION_OFF 0
+#define RANGE_TRANSLATION_RANGE_TLB 1 // a range TLB, backed by a range table per process, is searched on every TLB miss
+#define RANGE_TRANSLATION_DIRECT_SEGMENT 2 // each process' largest range is a direct segment. Accesses in it skip the TLB.
+#define RANGE_TRANSLATION_MODE RANGE_TRANSLATION_RANGE_TLB
+#define RANGE_TLB_SIZE 2 // number of entries in the fully associative range TLB
+#define MIN_RANGE_PAGES 2 // shortest run of pages recorded in a range table
+#define MAX_RANGES (NO_OF_PAGES / MIN_RANGE_PAGES)
+
+// TLB prefetching. On a TLB miss, the prefetcher predicts pages that will miss next and walks the page table for them ahead of time.
+#define TLB_PREFETCHER_NONE 0
+#define TLB_PREFETCHER_SEQUENTIAL 1 // prefetches the page after the one that missed
+#define TLB_PREFETCHER_STRIDE 2 // prefetches one stride ahead once the same stride between misses is seen twice in a row
+#define TLB_PREFETCHER_DISTANCE 3 // remembers which distances between misses followed each distance (Markov), and prefetches using them
+#define TLB_PREFETCHER TLB_PREFETCHER_SEQUENTIAL
+#define PREFETCH_BUFFER_SIZE 4 // number of entries in the prefetch buffer. Prefetched translations wait there, so they don't evict TLB entries.
+#define DISTANCE_TABLE_SIZE 16 // number of distances the distance prefetcher remembers
+#define DISTANCE_PREDICTIONS 2 // number of following distances remembered for each distance
+
+#define ZERO_FILL_ON_DEMAND 1 // 1 maps granted memory read-only on to a shared zero frame, and only allocates a frame on the first write to a page. 0 allocates every granted page up front.
+#define ZERO_FRAME_OWNER_ID -2 // what the zero frame shows as in the visualization of physical memory
+
+// Same-page merging. A scanner wakes up every now and then, and merges pages whose frames hold the same contents into a single copy-on-write frame.
+#define KSM_SCAN_INTERVAL 16 // number of memory accesses between wake-ups of the scanner
+#define KSM_PAGES_TO_SCAN 8 // mapped pages scanned per wake-up. A higher value merges sooner but costs more CPU time.
+#define KSM_HASH_COST_PER_BYTE 1 // cycles to checksum a byte of a page
+#define KSM_COMPARE_COST_PER_BYTE 1 // cycles to compare a byte of two pages
+
+// Swapping. When no frame is free, a page is evicted to make room. Evicted pages are compressed into a pool in memory (like zswap), and only written to the swap file when the pool is full.
+#define SWAP_FILE_SLOTS 256 // pages the swap file holds
+#define NO_OF_CPUS 2 // evictions run on the CPU whose process needs the frame, and each CPU allocates swap slots from a cluster of its own
+#define SWAP_CLUSTER_SIZE 8 // consecutive swap slots handed out to a CPU at a time (like the swap clusters of Linux), so pages evicted together sit together in the swap file
+#define NO_OF_SWAP_CLUSTERS (SWAP_FILE_SLOTS / SWAP_CLUSTER_SIZE) // 32
+#define SWAP_WRITE_BATCH_SIZE 8 // pages queued for the swap file before they're sorted by slot and written with one vectored write per run of consecutive slots. 1 writes each page on its own.
+#define ZSWAP_ENABLED 1 // 0 writes evicted pages straight to the swap file
+#define ZSWAP_POOL_FRAMES 4 // frames set aside for the compressed pool
+#define ZSWAP_POOL_OWNER_ID -3 // what the pool's frames show as in the visualization of physical memory
+#define ZSWAP_SIZE_CLASS_STEP 2 // compressed pages are stored in objects whose size is a multiple of 2 bytes. Each pool frame holds objects of a single size class (like zsmalloc).
+#define NO_OF_ZSWAP_SIZE_CLASSES (FRAME_SIZE / ZSWAP_SIZE_CLASS_STEP) // 8
+#define ZSWAP_MAX_COMPRESSED_SIZE (PAGE_SIZE * 3 / 4) // 12 bytes. Pages that don't compress below it go straight to the swap file.
+#define FAULT_AROUND 1 // 1 also swaps in a swapped out page's neighbours in its inner page table whose data is still in memory (in the pool or the swap write batch), into free frames, so that they don't fault later
+#define READAHEAD_INITIAL_WINDOW 2 // pages swapped in ahead of a swap-in fault that follows on from the last one
+#define READAHEAD_MAX_WINDOW 8 // the window doubles while faults stay sequential, up to 8 pages. 0 turns readahead off.
+#define LZ_MAX_LITERALS 128 // literals in one literal run of the LZ codec
+#define LZ_MIN_MATCH 2 // shortest match the LZ codec encodes
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 7) // 9. A match is a single byte: a flag bit, 3 bits of length and 4 bits of offset.
+#define LZ_MAX_OFFSET 16 // how far back a match may start
+
+#define PAGES_PER_HUGE_PAGE NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE // 4
+#define HUGE_PAGE_SIZE (PAGE_SIZE * PAGES_PER_HUGE_PAGE) // 64 bytes
+// A huge page is mapped by a single outer page table entry instead of a whole inner page table (like a 2MB page on x86-64).
+// It must start at a page number and a frame number that are multiples of PAGES_PER_HUGE_PAGE.
+
+#define ACCESSES_PER_PROCESS 64 // number of memory accesses the workload issues for each process
+#define WORKLOAD_UNMAP_INTERVAL 48 // every 48 accesses, a random page of the accessing process is unmapped (as if the process freed it)
+
+// Workload access patterns. Each process keeps its own position within its pages.
+#define WORKLOAD_PATTERN_RANDOM 0 // every access is to a random address
+#define WORKLOAD_PATTERN_SEQUENTIAL 1 // a process streams through its pages, WORKLOAD_SEQUENTIAL_STEP bytes at a time
+#define WORKLOAD_PATTERN_STRIDED 2 // a process skips WORKLOAD_STRIDE_PAGES pages between accesses
+#define WORKLOAD_PATTERN WORKLOAD_PATTERN_RANDOM
+#define WORKLOAD_SEQUENTIAL_STEP 4 // 4 bytes
+#define WORKLOAD_STRIDE_PAGES 2
+#define WORKLOAD_WRITE_PERCENT 25 // chance (in percent) that an access is a write
+#define WORKLOAD_FORK_INTERVAL 32 // every 32 accesses, the accessing process forks, if a process slot is free
+#define WORKLOAD_SHARED_MEMORY_INTERVAL 16 // every 16 accesses, the accessing process attaches a random shared memory segment
+#define WORKLOAD_SHARED_MEMORY_PERCENT 20 // chance (in percent) that an access of a process with shared memory attached is to a shared memory segment
+#define WORKLOAD_MESSAGE_INTERVAL 32 // every 32 accesses, the accessing process copies a message out of another process' memory
+
+// Costs (in cycles) of copying between the memory of two processes
+#define PROCESS_COPY_COST_PER_PAGE 30 // translating a page of either process and checking its permissions
+#define PROCESS_COPY_COST_PER_RUN 20 // starting a memcpy of a physically contiguous run
+#define PROCESS_COPY_COST_PER_BYTE 1 // copying a byte
+
+// Zero-copy message passing. Every WORKLOAD_MESSAGE_INTERVAL accesses, a message of 1, 2, 4 or 8 pages is also passed by remapping its pages, and the cycles charged for it are compared with those charged for copying it.
+#define NO_OF_MESSAGE_SIZES 4 // message sizes are powers of two, from 1 page to 2^(NO_OF_MESSAGE_SIZES - 1) pages
+#define REMAP_COST_PER_PAGE 60 // clearing the sender's page table entry, setting the receiver's and updating the reverse map
+
+// Asynchronous faults. A process whose access has to read a page from the swap file is suspended until the read completes, and the other processes run meanwhile.
+#define ASYNC_FAULTS 1 // 0 keeps a faulting process on its CPU, waiting, until its reads complete
+#define NO_OF_IO_WORKERS 2 // swap file reads in flight at once. Reads queue for a free worker.
+#define WORKLOAD_COMPUTE_TIME 50 // cycles a process runs for between its memory accesses
+#define SWAP_FILE_READ_TIME 5000 // cycles to read a page from the swap file
+
+// Cycle cost model. Every access path charges the cycles it takes to a cause, so runs report their average memory access time and where the time went. A process' CPU is busy for the cycles its accesses are charged, besides WORKLOAD_COMPUTE_TIME. Swap I/O is done by the I/O workers instead.
+#define TLB_LOOKUP_COST 1 // searching the TLB, paid by every access
+#define DATA_REFERENCE_COST 100 // reading or writing the data at the translated address in memory, when it misses in the caches
+#define MINOR_FAULT_COST 1000 // trapping into the kernel and handling a fault that needs no I/O: mapping the zero frame, zero fill or copy-on-write
+#define MAJOR_FAULT_COST 3000 // handling a fault that swaps a page in, besides reading it from the swap file: the trap, the swap slot lookup and decompression
+#define SWAP_FILE_WRITE_TIME 6000 // cycles to write a run of consecutive slots to the swap file with one vectored write
+#define TLB_SHOOTDOWN_COST 500 // invalidating a range of a process' translations wherever the MMU caches them
+
+// Causes cycles are charged to
+#define COST_TLB 0
+#define COST_PAGE_WALK 1 // page table references of walks, coalescing and the prefetcher
+#define COST_DATA 2
+#define COST_MINOR_FAULT 3
+#define COST_MAJOR_FAULT 4
+#define COST_SWAP_IO 5 // swap file reads
+#define COST_TLB_SHOOTDOWN 6
+#define COST_SHADOW_PAGING 7 // traps on guest page table writes and shadow synchronization, under shadow paging
+#define COST_IOMMU 8 // I/O page table writes, I/O page walks and IOTLB invalidations
+#define COST_KSM 9 // checksumming and comparing pages to merge
+#define COST_PROCESS_COPY 10 // copies between processes and zero-copy remapping
+#define COST_HUGE_PAGE_COPY 11 // pages copied into huge pages by the huge page daemon
+#define COST_FORK 12 // page table entries read and written by fork
+#define COST_SWAP_WRITE 13 // swap file writes of evicted pages, done by the I/O workers in the background
+#define NO_OF_COST_CAUSES 14
+
+// CPU cache hierarchy. Page table entries and data are cached in physically indexed, set-associative caches with LRU replacement. A reference costs the hit latency of the first level it hits in, or a memory reference if it misses in all of them. Page tables live outside simulated physical memory, so their entries are given addresses past its end (see get_page_table_entry_address).
+#define CACHE_LINE_SIZE 8 // bytes; two page table entries per line, two lines per frame
+#define NO_OF_CACHE_LEVELS 3 // L1, L2 and the last-level cache
+#define L1_CACHE_SIZE 64 // bytes
+#define L1_CACHE_ASSOCIATIVITY 2
+#define L1_CACHE_HIT_COST 4
+#define L2_CACHE_SIZE 256
+#define L2_CACHE_ASSOCIATIVITY 4
+#define L2_CACHE_HIT_COST 12
+#define LLC_SIZE 1024
+#define LLC_ASSOCIATIVITY 8 // 16 sets, so a way spans 128 bytes: 8 frames
+#define LLC_HIT_COST 40
+#define MAX_CACHE_LINES (LLC_SIZE / CACHE_LINE_SIZE) // the largest level
+#define CACHE_POLICY_INCLUSIVE 0 // every line in L1 or L2 is in the LLC too. A line evicted from the LLC is invalidated in L1 and L2 (back-invalidation).
+#define CACHE_POLICY_EXCLUSIVE 1 // a line is in one level at a time. Misses fill L1, a hit in L2 or the LLC moves the line up to L1, and lines evicted from a level move down to the next.
+#define CACHE_POLICY CACHE_POLICY_INCLUSIVE
+#define PAGE_TABLE_MEMORY_BASE PHYSICAL_MEMORY_SIZE // where the page tables of process 0 start. Each process' outer page table is followed by its inner page tables.
+#define PROCESS_PAGE_TABLE_MEMORY_SIZE (OUTER_PAGE_TABLE_SIZE * PAGE_TABLE_ENTRY_SIZE * (1 + NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE)) // 1280 bytes
+#define SHARED_PAGE_TABLE_MEMORY_BASE (PAGE_TABLE_MEMORY_BASE + MAX_PROCESS_COUNT * PROCESS_PAGE_TABLE_MEMORY_SIZE) // where the inner page tables of shared memory segments start
+
+// Kinds of cache references
+#define CACHE_REFERENCE_DATA 0
+#define CACHE_REFERENCE_PAGE_TABLE 1 // page table entries read by radix walks and coalescing
+
+// Page coloring. A frame's color is the bits of its frame number that select the LLC sets its lines map on to, so frames of different colors never conflict in the LLC. L1 and L2 ways span less than a frame, so every frame maps on to all of their sets.
+#define NO_OF_PAGE_COLORS (LLC_SIZE / LLC_ASSOCIATIVITY / FRAME_SIZE) // 8; frame i has color i % NO_OF_PAGE_COLORS
+#define PAGE_COLORING_OFF 0 // frames are given first-fit, whatever their color
+#define PAGE_COLORING_ROUND_ROBIN 1 // each process takes its frames from every color in turn, spreading its pages evenly over the LLC sets
+#define PAGE_COLORING_PARTITIONED 2 // each group of processes takes its frames from colors of its own, in turn, so that groups don't evict each other's lines from the LLC
+#define PAGE_COLORING PAGE_COLORING_ROUND_ROBIN
+#define PAGE_COLOR_PARTITIONS 4 // groups of processes under partitioned page coloring. Process i is in group i % PAGE_COLOR_PARTITIONS, and owns NO_OF_PAGE_COLORS / PAGE_COLOR_PARTITIONS colors.
+
+// Discrete-event simulation. The workload is driven by a queue of timestamped events. NO_OF_CPUS CPUs each run a process for a time quantum, and a process leaves the workload after ACCESSES_PER_PROCESS accesses.
+#define SCHEDULER_ROUND_ROBIN 0 // processes take turns, in the order they became ready
+#define SCHEDULER_RANDOM 1 // a random ready process runs next
+#define SCHEDULER SCHEDULER_ROUND_ROBIN
+#define TIME_QUANTUM 4000 // cycles a process runs for before another ready process gets its CPU
+#define MAX_PENDING_EVENTS 64 // at most one event per CPU, one per process and one per daemon are pending at a time
+#define EVENT_QUEUE_BENCHMARK_EVENTS 1000000 // events taken from the queue (and posted again) after the workload, to time the queue
+#define EVENT_QUEUE_BENCHMARK_PENDING 32 // events pending while the queue is timed
+#define NO_OF_EVENT_BUCKETS 65 // buckets of the radix heap the events are queued in: one per bit of the time where an event may differ from the last event taken, and one for events at the same time
+#define HUGE_PAGE_DAEMON_PERIOD (HUGE_PAGE_DAEMON_SCAN_INTERVAL * WORKLOAD_COMPUTE_TIME / NO_OF_CPUS) // cycles between wake-ups of the huge page daemon, as long as every CPU takes to make HUGE_PAGE_DAEMON_SCAN_INTERVAL accesses
+#define KSM_PERIOD (KSM_SCAN_INTERVAL * WORKLOAD_COMPUTE_TIME / NO_OF_CPUS) // cycles between wake-ups of the same-page merging scanner
+
+// Event types
+#define EVENT_PROCESS_ARRIVAL 0 // a process joins the workload and becomes ready
+#define EVENT_PROCESS_EXIT 1 // a process that made all its accesses leaves the workload, once its last reads complete
+#define EVENT_ACCESS 2 // the process running on a CPU makes its next access
+#define EVENT_DISPATCH 3 // a CPU's quantum is over or its process stopped running, so it picks the next ready process
+#define EVENT_READ_COMPLETION 4 // the swap file reads of a suspended process complete and it becomes ready again
+#define EVENT_HUGE_PAGE_DAEMON_WAKEUP 5
+#define EVENT_KSM_WAKEUP 6
+
+// Huge page daemon tunables
+#define HUGE_PAGE_DAEMON_SCAN_INTERVAL 16 // number of memory accesses between wake-ups of the daemon
+#define HUGE_PAGE_DAEMON_TABLES_TO_SCAN 8 // inner page tables scanned per wake-up. A higher value collapses sooner but scans more.
+#define HUGE_PAGE_DAEMON_MAX_PTES_NONE 1 // unpopulated entries an inner page table may have and still be collapsed. Each one costs a frame of memory bloat. 0 only collapses fully populated spans.
+#define HUGE_PAGE_COPY_COST_PER_BYTE 1 // copying a byte of a page into the huge page's frames
+
+// Page table structures the MMU can walk. Chosen at startup.
+#define PAGE_TABLE_MODE_RADIX 0 // the per-process two-level (hierarchical) page tables
+#define PAGE_TABLE_MODE_INVERTED 1 // one global inverted page table, searched through a hash anchor table
+#define PAGE_TABLE_MODE_CUCKOO 2 // per-process elastic cuckoo hashed page tables, one per page size
+
+#define HASH_ANCHOR_TABLE_SIZE NO_OF_FRAMES // 64 slots, each the head of a chain of inverted page table entries
+#define HASH_ANCHOR_TABLE_ENTRY_SIZE 4 // 4 bytes
+#define INVERTED_PAGE_TABLE_ENTRY_SIZE 8 // 8 bytes: process id, page number and the index of the next entry in the chain
+
+// Elastic cuckoo hashed page tables
+#define NO_OF_PAGE_SIZES 2
+#define SMALL_PAGE_SIZE_INDEX 0 // cuckoo page table of small pages, keyed by page number
+#define HUGE_PAGE_SIZE_INDEX 1 // cuckoo page table of huge pages, keyed by inner page table number
+#define CUCKOO_WAYS 3 // d. Each way is a separate hash table with its own hash function (at most 4). A lookup probes every way in parallel.
+#define CUCKOO_INITIAL_WAY_SIZE 4 // slots per way when a cuckoo page table is created
+#define CUCKOO_MAX_KICKS 16 // how many entries an insertion may displace before the table is considered full
+#define CUCKOO_RESIZE_THRESHOLD 60 // occupancy (in percent) at which a gradual resize to double the size starts
+#define CUCKOO_SLOTS_MIGRATED_PER_INSERT 2 // slots of each old way moved to the new ways by every insertion during a resize
+#define CUCKOO_PAGE_TABLE_ENTRY_SIZE 8 // 8 bytes: page number and frame number
+#define CUCKOO_WALK_CACHE_SIZE 4 // entries in the cuckoo walk cache. Each entry records which page sizes are mapped in one inner page table's span of pages.
+
+// Nested paging. A guest process' page table entries hold guest-physical frame numbers, which the host page table of the guest maps on to (host-physical) frames.
+// The guest's page tables are themselves in guest-physical memory, so every guest page table entry read needs a host page table walk first.
+// With n guest levels and m host levels, a walk makes (n+1)(m+1)-1 references: 24 for 4+4 levels, 8 for this MMU's 2+2 levels.
+#define GUEST_PROCESS_PERCENT 50 // chance (in percent) that a newly created process is a guest of a virtual machine
+#define GUEST_PAGE_TABLE_FRAMES (OUTER_PAGE_TABLE_SIZE + 1) // guest-physical frames holding a guest's page tables: one per inner page table, plus the outer page table
+#define GUEST_DATA_FRAMES NO_OF_PAGES // guest-physical frames holding data: one for every page, since pages that share a frame (the zero frame, merged or forked frames) each get a guest-physical frame of their own
+#define GUEST_PHYSICAL_FRAMES (GUEST_DATA_FRAMES + GUEST_PAGE_TABLE_FRAMES) // guest-physical frames 0-255 hold data. The rest hold the guest's page tables.
+#define HOST_OUTER_PAGE_TABLE_SIZE ((GUEST_PHYSICAL_FRAMES + NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE - 1) / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE) // 81
+#define HYPERVISOR_FRAME -2 // host page table entries of guest page table frames map on to hypervisor memory outside the simulated physical memory
+#define NESTED_WALK_CACHE_SIZE 4 // entries in the nested walk cache, which caches guest-physical to host-physical frame translations
+#define MAX_NESTED_WALK_REFERENCES ((2 + 1) * (2 + 1) - 1) // 8
+
+// Virtualization modes
+#define VIRTUALIZATION_MODE_NESTED 0 // guest page tables are walked in two dimensions through the host page table
+#define VIRTUALIZATION_MODE_SHADOW 1 // the hypervisor keeps a shadow page table mapping guest pages straight on to frames, walked natively. Every guest page table write traps to the hypervisor so the shadow can be synchronized.
+#define VIRTUALIZATION_MODE VIRTUALIZATION_MODE_NESTED
+// Costs (in cycles) used to compare the two modes. The cycle cost model charges PAGE_WALK_REFERENCE_COST for every page table reference too.
+#define PAGE_WALK_REFERENCE_COST 100 // reading a page table entry from memory, when it misses in the caches
+#define SHADOW_PAGE_TABLE_TRAP_COST 1500 // a VM exit on a guest page table write and the re-entry into the guest
+#define SHADOW_PAGE_TABLE_SYNC_COST 50 // updating a shadow page table entry
+
+// IOMMU. DMA devices address memory with I/O virtual addresses, which the IOMMU translates through each device's I/O page table.
+#define NO_OF_DMA_DEVICES 2
+#define IO_VIRTUAL_PAGES 64 // pages in each device's I/O virtual address space
+#define IO_OUTER_PAGE_TABLE_SIZE (IO_VIRTUAL_PAGES / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE) // 16
+#define DMA_IO_INTERVAL 8 // every 8 accesses, the accessing process does an I/O through a random device
+#define DMA_MAX_IO_PAGES 2 // an I/O transfers between 1 and 2 pages
+#define DMA_ACCESSES_PER_PAGE 4 // device accesses to each page of an I/O buffer
+#define IOMMU_UNMAP_STRICT 0 // every unmap invalidates the IOTLB at once and waits for the invalidation to complete
+#define IOMMU_UNMAP_LAZY 1 // unmaps queue their invalidations, which are done in one batch when the queue fills. The I/O virtual pages can't be reused until then.
+#define IOMMU_UNMAP_MODE IOMMU_UNMAP_LAZY
+#define INVALIDATION_QUEUE_SIZE 8 // unmaps waiting for their IOTLB invalidation
+#define IOMMU_PAGE_TABLE_WRITE_COST 20 // cycles to write an I/O page table entry
+#define IOTLB_INVALIDATION_COST 2000 // cycles to issue an IOTLB invalidation and wait for it to complete
+#define SCATTER_GATHER_INTERVAL 16 // every 16 accesses, the accessing process does a scatter-gather I/O of its whole memory
+#define MAX_SCATTER_GATHER_EXTENTS 8 // extents in a scatter-gather list. A longer I/O is split.
+
+// Shared memory. Named segments of frames that processes attach at addresses of their own choosing.
+#define NO_OF_SHARED_MEMORY_SEGMENTS 2
+#define SHARED_MEMORY_NAME_LENGTH 16
+#define SHARED_MEMORY_SEGMENT_PAGES 8 // a multiple of NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE, so that a segment fills whole inner page tables
+#define SHARED_MEMORY_INNER_PAGE_TABLES (SHARED_MEMORY_SEGMENT_PAGES / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE) // 2
+#define SHARE_INNER_PAGE_TABLES 1 // 1 lets processes attached at an aligned address share the segment's inner page tables. 0 gives each process its own page table entries.
+
 
 /**
  * @brief A struct representing a page table entry.
  * The page table array is of type page_table_entry.
  * @param frame_number - Of type int. The number of the frame the page being represented maps on to.
  * @param valid - Of type boolean. Indicates whether a page has a corresponding frame
+ * @param guest_frame_number - Of type int. For a guest process, the guest-physical frame number the guest's page table entry holds. The host page table maps it on to frame_number.
+ * @param writable - Indicates whether the page may be written. A mapped page that isn't writable is shared copy-on-write with another process.
+ * @param swap_slot - For a page that was evicted, the slot of the swap file it was swapped out to. -1 if the page isn't swapped out.
+ * @param accessed - Set by the MMU when the page is read or written. The eviction clock clears it, giving recently used pages a second chance.
+ * @param dirty - Set by the MMU when the page is written.
  */
 struct page_table_entry
 {
     int frame_number;
     int valid;
+    int guest_frame_number;
+    int writable;
+    int swap_slot;
+    int accessed;
+    int dirty;
 };
 
 /**
@@ -62,13 +312,19 @@ struct page_table_entry
  * @param id - The id of the process. Generated sequentially.
  * @param size - The size of the process in bytes. Determines the number of frames it will require. For example, a process of size 12 bytes in an MMU using pages of size 4 bytes will require 3 pages. If a process requires 3 pages, it requires n frames since frame size is equal to frame size.
  * @param size_in_memory The amount of space in memory the process is occupying. It's an int value.
+ * @param start_page_number The first page the process occupies in virtual memory. It's -1 if the process hasn't been assigned a page.
  * @param inner_page_tables A 2D array representing the inner page tables of a process.
+ * @param huge_pages Indicates, for each outer page table entry, whether it maps a huge page directly. If it does, the entries of its inner page table point to the consecutive frames of the huge page.
+ * @param is_guest Indicates whether the process runs in a virtual machine, in which case its translations are nested.
  */
 struct PCB {
     int id;
     int size;
     int size_in_memory;
+    int start_page_number;
     struct page_table_entry inner_page_tables[OUTER_PAGE_TABLE_SIZE][NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+    int huge_pages[OUTER_PAGE_TABLE_SIZE];
+    int is_guest;
 };
 
 
@@ -84,14 +340,597 @@ struct page
 };
 
 
+/**
+ * @brief A struct representing a TLB entry. An entry can cover more than one page (e.g. a huge page), in which case the pages map on to consecutive frames.
+ * @param valid Indicates whether the entry holds a translation.
+ * @param process_id The id of the process the translation belongs to.
+ * @param page_number The first page covered by the entry.
+ * @param frame_number The frame the first page maps on to.
+ * @param no_of_pages The number of pages covered by the entry.
+ * @param last_used The TLB clock value of the last lookup that hit the entry. Used for LRU replacement.
+ */
+struct tlb_entry
+{
+    int valid;
+    int process_id;
+    int page_number;
+    int frame_number;
+    int no_of_pages;
+    unsigned long last_used;
+};
+
+/**
+ * @brief A struct representing a fully associative TLB with LRU replacement.
+ * @param entries The entries of the TLB.
+ * @param hits The number of lookups that found a translation.
+ * @param misses The number of lookups that required a page table walk.
+ */
+struct tlb
+{
+    struct tlb_entry entries[TLB_SIZE];
+    int hits;
+    int misses;
+};
+
+/**
+ * @brief A struct representing a range: a run of consecutive pages that map on to consecutive frames.
+ * @param base The first page of the range.
+ * @param limit The page right after the last page of the range.
+ * @param offset The frame number of a page of the range minus its page number.
+ */
+struct range_table_entry
+{
+    int base;
+    int limit;
+    int offset;
+};
+
+/**
+ * @brief A struct representing a process' range table. It's sorted by base, so a range table walk is a binary search.
+ * @param ranges The ranges of the process.
+ * @param no_of_ranges The number of ranges.
+ * @param is_stale Indicates whether a mapping changed since the ranges were last found. A stale range table is rebuilt before it's walked.
+ */
+struct range_table
+{
+    struct range_table_entry ranges[MAX_RANGES];
+    int no_of_ranges;
+    int is_stale;
+};
+
+/**
+ * @brief A struct representing a range TLB entry.
+ * @param valid Indicates whether the entry holds a range.
+ * @param process_id The id of the process the range belongs to.
+ * @param range The range.
+ * @param last_used The TLB clock value of the last lookup that hit the entry. Used for LRU replacement.
+ */
+struct range_tlb_entry
+{
+    int valid;
+    int process_id;
+    struct range_table_entry range;
+    unsigned long last_used;
+};
+
+/**
+ * @brief A struct representing an entry of the distance prefetcher's table.
+ * @param valid Indicates whether the entry holds a distance.
+ * @param distance The distance between two consecutive TLB misses of a process, in pages.
+ * @param next_distances The distances that followed it, most recent first. 0 means none.
+ * @param last_used The TLB clock value of the last time the entry was used. Used for LRU replacement.
+ */
+struct distance_table_entry
+{
+    int valid;
+    int distance;
+    int next_distances[DISTANCE_PREDICTIONS];
+    unsigned long last_used;
+};
+
+/**
+ * @brief A struct representing a DMA device behind the IOMMU.
+ * @param io_page_tables The inner page tables of the device's I/O page table, which maps I/O virtual pages on to frames.
+ * @param is_io_page_pending Indicates, for each I/O virtual page, whether it was unmapped but its IOTLB invalidation is still queued. Such a page can't be mapped again yet.
+ */
+struct dma_device
+{
+    struct page_table_entry io_page_tables[IO_OUTER_PAGE_TABLE_SIZE][NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+    int is_io_page_pending[IO_VIRTUAL_PAGES];
+};
+
+/**
+ * @brief A struct representing a shared memory segment.
+ * @param name The name processes open the segment by. It's empty if the segment isn't in use.
+ * @param frame_numbers The frames of the segment's pages. They needn't be consecutive.
+ * @param no_of_attachments The number of processes the segment is attached to. The segment is destroyed when the last one detaches it.
+ * @param inner_page_tables The inner page tables mapping the segment, which processes attached at an aligned address point their outer page table entries at.
+ * @param has_inner_page_tables Indicates whether the inner page tables have been filled in.
+ */
+struct shared_memory_segment
+{
+    char name[SHARED_MEMORY_NAME_LENGTH];
+    int frame_numbers[SHARED_MEMORY_SEGMENT_PAGES];
+    int no_of_attachments;
+    struct page_table_entry inner_page_tables[SHARED_MEMORY_INNER_PAGE_TABLES][NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+    int has_inner_page_tables;
+};
+
+/**
+ * @brief A struct representing a node of a same-page merging tree. The nodes are kept in an array and sorted by the contents of their frames.
+ * @param frame_number The frame whose contents the node stands for.
+ * @param process_id In the unstable tree, the process the page that was scanned belongs to.
+ * @param page_number In the unstable tree, the page that was scanned. If it no longer maps on to frame_number, the node is stale.
+ * @param left The index of the node with smaller contents, -1 if there is none.
+ * @param right The index of the node with greater contents, -1 if there is none.
+ */
+struct ksm_tree_node
+{
+    int frame_number;
+    int process_id;
+    int page_number;
+    int left;
+    int right;
+};
+
+/**
+ * @brief A struct representing a page stored in the compressed pool.
+ * @param is_stored Indicates whether the swap slot's page is in the pool. If it isn't, it's in the swap file.
+ * @param pool_frame_index The pool frame the compressed page is in.
+ * @param object_index The object of the pool frame the compressed page is in.
+ * @param compressed_size The size of the compressed page in bytes.
+ * @param stored_at The pool clock value when the page was stored. The oldest page is written back first when the pool is full.
+ */
+struct zswap_entry
+{
+    int is_stored;
+    int pool_frame_index;
+    int object_index;
+    int compressed_size;
+    unsigned long stored_at;
+};
+
+/**
+ * @brief A struct representing a frame of the compressed pool. It's divided into objects of a single size class.
+ * @param frame_number The frame.
+ * @param size_class The size of the frame's objects in bytes. 0 if the frame holds no objects.
+ * @param no_of_used_objects The number of objects holding a compressed page.
+ * @param used_objects A bit per object, set if the object holds a compressed page.
+ */
+struct zswap_pool_frame
+{
+    int frame_number;
+    int size_class;
+    int no_of_used_objects;
+    unsigned int used_objects;
+};
+
+/**
+ * @brief A struct representing a page waiting in the write batch to be written to the swap file.
+ * @param swap_slot The swap slot the page is written to.
+ * @param page The contents of the page.
+ */
+struct swap_write
+{
+    int swap_slot;
+    unsigned char page[PAGE_SIZE];
+};
+
+/**
+ * @brief A struct representing an event of the discrete-event simulation.
+ * @param time The simulated time the event happens at, in cycles.
+ * @param type What happens (EVENT_...).
+ * @param id The process or CPU the event is for. -1 for daemon wake-ups.
+ * @param next The next event in the same bucket of the event queue, or in the free list. -1 if none.
+ */
+struct event
+{
+    long time;
+    int type;
+    int id;
+    int next;
+};
+
+/**
+ * @brief A struct representing a line of a CPU cache.
+ * @param line_address The physical address of the line divided by CACHE_LINE_SIZE. -1 if the line is empty.
+ * @param last_used The cache clock value of the last reference to the line. Used for LRU replacement.
+ */
+struct cache_line
+{
+    int line_address;
+    unsigned long last_used;
+};
+
+/**
+ * @brief A struct representing one level of the CPU cache hierarchy. Set i holds lines i * associativity to (i + 1) * associativity - 1.
+ * @param name The name of the level, for the stats.
+ * @param lines The lines of the cache. Only the first no_of_sets * associativity are used.
+ * @param no_of_sets The number of sets.
+ * @param associativity The number of lines in a set.
+ * @param hit_cost The cycles a reference that hits in this level takes.
+ * @param hits The number of references of each kind (CACHE_REFERENCE_...) that hit in this level.
+ * @param misses The number of references of each kind that were looked up in this level and missed.
+ */
+struct cache
+{
+    const char *name;
+    struct cache_line lines[MAX_CACHE_LINES];
+    int no_of_sets;
+    int associativity;
+    int hit_cost;
+    int hits[2];
+    int misses[2];
+};
+
+/**
+ * @brief A struct representing an extent: a run of consecutive bytes of physical memory.
+ * @param physical_address The physical address of the first byte.
+ * @param length The length of the extent in bytes.
+ */
+struct physical_extent
+{
+    int physical_address;
+    int length;
+};
+
+/**
+ * @brief A struct representing a buffer in the memory of a process (like struct iovec).
+ * @param logical_address The logical address of the buffer.
+ * @param length The length of the buffer in bytes.
+ */
+struct memory_vector
+{
+    int logical_address;
+    int length;
+};
+
+/**
+ * @brief A struct representing an unmap waiting in the invalidation queue.
+ * @param device_id The device the I/O virtual pages belong to.
+ * @param io_page_number The first unmapped I/O virtual page.
+ * @param no_of_pages The number of unmapped pages.
+ */
+struct invalidation_request
+{
+    int device_id;
+    int io_page_number;
+    int no_of_pages;
+};
+
+/**
+ * @brief A struct representing an entry of the nested walk cache.
+ * @param valid Indicates whether the entry holds a translation.
+ * @param process_id The id of the guest process the guest-physical frame belongs to.
+ * @param guest_frame_number The guest-physical frame.
+ * @param frame_number The frame the host page table maps it on to.
+ * @param last_used The TLB clock value of the last lookup that hit the entry. Used for LRU replacement.
+ */
+struct nested_walk_cache_entry
+{
+    int valid;
+    int process_id;
+    int guest_frame_number;
+    int frame_number;
+    unsigned long last_used;
+};
+
+/**
+ * @brief A struct representing an inverted page table entry. There is one entry per frame, and the entry's index in the inverted page table is the frame number.
+ * @param process_id The id of the process whose page is in the frame. It's -1 if the frame isn't mapped.
+ * @param page_number The page that is in the frame.
+ * @param next The index of the next entry in the same hash chain. It's -1 at the end of the chain.
+ */
+struct inverted_page_table_entry
+{
+    int process_id;
+    int page_number;
+    int next;
+};
+
+/**
+ * @brief A struct representing an entry of a cuckoo page table.
+ * @param valid Indicates whether the slot holds an entry.
+ * @param page_number The key. For the huge page table, it's the inner page table number of the huge page.
+ * @param frame_number The frame the page (or the first page of the huge page) maps on to.
+ */
+struct cuckoo_page_table_entry
+{
+    int valid;
+    int page_number;
+    int frame_number;
+};
+
+/**
+ * @brief A struct representing an elastic cuckoo hashed page table. While it's being resized, the old and new ways exist side by side. The slots of an old way below its rehash pointer have already been moved to the new way, so a key whose slot in the old way is below the rehash pointer lives in the new way. A lookup therefore still probes only one slot per way.
+ * @param ways The ways of the table (the old ways during a resize).
+ * @param new_ways The ways being resized into. Each is NULL when the table isn't being resized.
+ * @param way_size The number of slots in each way.
+ * @param new_way_size The number of slots in each new way.
+ * @param rehash_pointers The number of slots of each old way that have been moved to the new way.
+ * @param no_of_entries The number of entries in the table.
+ */
+struct cuckoo_page_table
+{
+    struct cuckoo_page_table_entry *ways[CUCKOO_WAYS];
+    struct cuckoo_page_table_entry *new_ways[CUCKOO_WAYS];
+    int way_size;
+    int new_way_size;
+    int rehash_pointers[CUCKOO_WAYS];
+    int no_of_entries;
+};
+
+/**
+ * @brief A struct representing an entry of the cuckoo walk cache.
+ * @param valid Indicates whether the entry holds information.
+ * @param process_id The id of the process the span belongs to.
+ * @param inner_page_table_no The span of pages, identified by the inner page table that covers it.
+ * @param page_sizes A bit for each page size mapped in the span (1 << SMALL_PAGE_SIZE_INDEX, 1 << HUGE_PAGE_SIZE_INDEX).
+ * @param last_used The TLB clock value of the last lookup that hit the entry. Used for LRU replacement.
+ */
+struct cuckoo_walk_cache_entry
+{
+    int valid;
+    int process_id;
+    int inner_page_table_no;
+    int page_sizes;
+    unsigned long last_used;
+};
+
 
 // Row value represents number of frames or pages. Column value represents number of bytes within a frame or page.
 struct PCB physical_memory [NO_OF_FRAMES][FRAME_SIZE]; // [64][16]
+unsigned char frame_contents[NO_OF_FRAMES][FRAME_SIZE]; // the bytes stored in each frame. physical_memory only records who each byte belongs to.
 struct page virtual_memory[NO_OF_PAGES][PAGE_SIZE]; // [256][16]
 struct PCB* processes[MAX_PROCESS_COUNT]; // an array holding all processes. note that this isn't physical or virtual memory.
 int no_of_page_faults = 0;
 int no_of_page_hits = 0;
 int available_physical_memory = PHYSICAL_MEMORY_SIZE;
+int frame_reference_counts[NO_OF_FRAMES]; // number of page table entries (or DMA mappings) using each frame. A frame is only freed when its count drops to 0.
+int zero_frame_number = -1; // the frame every untouched page maps on to. It's never freed. -1 if zero-fill-on-demand is off.
+int no_of_pages_reserved = 0; // granted pages mapped on to the zero frame instead of a frame of their own
+int no_of_zero_fill_faults = 0; // first writes to pages mapped on to the zero frame
+int no_of_zero_frame_mappings = 0; // measured at the end of the workload
+int no_of_resident_frames = 0; // frames in use, besides the zero frame, measured at the end of the workload
+
+// Reverse map. Links every page table entry mapping a frame, so that all the mappings of a frame can be found. Entry i stands for page i % NO_OF_PAGES of process i / NO_OF_PAGES.
+int reverse_map_heads[NO_OF_FRAMES]; // first mapping of each frame, -1 if the frame isn't mapped
+int reverse_map_next[MAX_PROCESS_COUNT * NO_OF_PAGES]; // next mapping of the same frame, -1 if it's the last
+
+struct ksm_tree_node stable_tree[NO_OF_FRAMES]; // merged frames
+int stable_tree_root = -1;
+int stable_tree_size = 0;
+struct ksm_tree_node unstable_tree[NO_OF_FRAMES]; // pages seen unchanged for a whole scan. Emptied after every full scan.
+int unstable_tree_root = -1;
+int unstable_tree_size = 0;
+int is_ksm_frame[NO_OF_FRAMES]; // whether each frame is a merged frame in the stable tree
+unsigned int page_checksums[MAX_PROCESS_COUNT][NO_OF_PAGES]; // checksum of each page at its last scan. Pages that changed since aren't put in the unstable tree.
+int ksm_cursor = 0; // the next page the scanner looks at, counted across all processes
+int no_of_ksm_full_scans = 0;
+int no_of_ksm_pages_scanned = 0;
+int no_of_ksm_merges = 0; // pages merged into a frame of the stable tree
+int no_of_ksm_frames_freed = 0;
+int no_of_ksm_unmerges = 0; // writes to merged pages, which gave the page a copy of its own
+long ksm_bytes_hashed = 0;
+long ksm_bytes_compared = 0;
+
+FILE *swap_file = NULL;
+int swap_map[SWAP_FILE_SLOTS]; // number of page table entries holding each swap slot, 0 if the slot is free
+struct zswap_entry zswap_entries[SWAP_FILE_SLOTS]; // indexed by swap slot
+int swap_clusters[NO_OF_CPUS]; // the cluster each CPU allocates swap slots from, -1 if it has none
+int swap_cluster_offsets[NO_OF_CPUS]; // where in its cluster each CPU looks for the next free slot
+struct swap_write swap_write_batch[SWAP_WRITE_BATCH_SIZE]; // pages waiting to be written to the swap file
+int no_of_pending_swap_writes = 0;
+struct zswap_pool_frame zswap_pool[ZSWAP_POOL_FRAMES];
+unsigned long zswap_clock = 0;
+int eviction_clock_hand = 0; // the next frame looked at for eviction
+int no_of_evictions = 0;
+int no_of_dirty_evictions = 0; // evicted pages that had been written since they were mapped
+int no_of_swap_ins = 0;
+int no_of_zswap_stores = 0;
+int no_of_zswap_rejections = 0; // pages that didn't compress well enough for the pool
+int no_of_zswap_loads = 0; // swap-ins served by the pool
+int no_of_zswap_writebacks = 0; // pages written back to the swap file to make room in the pool
+int no_of_swap_file_writes = 0;
+int no_of_swap_file_reads = 0;
+int no_of_swap_write_ios = 0; // vectored writes issued to the swap file
+int no_of_swap_batch_hits = 0; // swap file reads served by a page still waiting in the write batch
+int no_of_swap_clusters_allocated = 0;
+int no_of_swap_slot_fallbacks = 0; // slots allocated one at a time because no whole cluster was free
+long zswap_uncompressed_bytes = 0;
+long zswap_compressed_bytes = 0;
+
+int is_faulted_around[MAX_PROCESS_COUNT][NO_OF_PAGES]; // pages mapped by fault-around that haven't been accessed yet
+int is_read_ahead[MAX_PROCESS_COUNT][NO_OF_PAGES]; // pages swapped in by readahead that haven't been accessed yet
+int readahead_windows[MAX_PROCESS_COUNT]; // the current readahead window of each process in pages, 0 after a random fault
+int last_swap_in_faults[MAX_PROCESS_COUNT]; // the page of each process' last swap-in fault, -1 if none
+int readahead_next_pages[MAX_PROCESS_COUNT]; // the page right after each process' last readahead window
+int readahead_pinned_frame = -1; // the frame of the faulting page while pages are read ahead of it, which isn't evicted to make room for them
+int no_of_pages_faulted_around = 0;
+int no_of_fault_around_hits = 0;
+int no_of_fault_around_pages_wasted = 0; // unmapped before they were accessed
+int no_of_pages_read_ahead = 0;
+int no_of_readahead_hits = 0;
+int no_of_readahead_pages_wasted = 0; // unmapped or evicted before they were accessed
+
+long no_of_bytes_loaded = 0;
+long no_of_bytes_stored = 0;
+int no_of_physical_runs_copied = 0; // memcpy calls made by loads and stores, one per physically contiguous run
+
+int no_of_process_copies = 0;
+long no_of_bytes_copied_between_processes = 0;
+int no_of_process_copy_pages_translated = 0; // pages of either process translated by copies
+int no_of_process_copy_runs = 0; // memcpy calls made by copies, one per run that is physically contiguous in both processes
+
+int no_of_scatter_gather_ios = 0;
+int no_of_scatter_gather_lists = 0; // an I/O with more extents than a list holds is split into several lists
+int no_of_scatter_gather_extents = 0;
+int no_of_scatter_gather_pages = 0;
+int no_of_range_translation_references = 0; // page table entries read by translate_range
+int no_of_range_translation_faults = 0; // pages faulted in by scatter-gather I/Os, because translate_range stopped at them
+
+int no_of_remaps = 0;
+int no_of_pages_remapped = 0;
+int no_of_shared_pages_remapped = 0; // pages whose frame was shared, so the receiver maps it copy-on-write
+int no_of_pages_copied_by_remaps = 0; // shared memory pages, which can't be taken from the sender
+int no_of_messages[NO_OF_MESSAGE_SIZES];
+long message_copy_cost[NO_OF_MESSAGE_SIZES]; // cycles charged while copying the messages, to every cause
+long message_remap_cost[NO_OF_MESSAGE_SIZES]; // cycles charged while remapping the messages, to every cause
+
+struct tlb tlb;
+struct tlb baseline_tlb; // a TLB that only caches small pages. It's fed the same accesses as the TLB to measure how many misses huge pages save.
+unsigned long tlb_clock = 0;
+int no_of_memory_accesses = 0;
+int no_of_page_walk_references = 0;
+int no_of_coalesced_tlb_fills = 0;
+int no_of_pages_coalesced = 0; // pages covered by coalesced fills, on top of the page that missed
+long tlb_reach_samples = 0; // pages covered by the valid entries of the TLB, summed over every access
+long baseline_tlb_reach_samples = 0;
+
+struct range_table range_tables[MAX_PROCESS_COUNT]; // indexed by process id
+struct range_tlb_entry range_tlb[RANGE_TLB_SIZE];
+int no_of_range_tlb_hits = 0;
+int no_of_range_tlb_misses = 0;
+int no_of_range_table_walks = 0;
+int no_of_range_table_walk_references = 0;
+int no_of_direct_segment_accesses = 0;
+
+int workload_positions[MAX_PROCESS_COUNT]; // offset of each process' next access from its first page, for the sequential and strided patterns
+
+long simulated_time = 0; // cycles since the workload started
+long io_worker_free_times[NO_OF_IO_WORKERS]; // when each I/O worker finishes its last read
+int no_of_major_faults = 0; // workload steps that read from the swap file
+int no_of_process_suspensions = 0;
+long io_worker_busy_time = 0;
+long cpu_io_wait_time = 0; // cycles CPUs spent waiting for the reads of their process, when faults aren't asynchronous
+
+struct event events[MAX_PENDING_EVENTS];
+int event_buckets[NO_OF_EVENT_BUCKETS]; // first event of each bucket of the radix heap, -1 if empty. Bucket i > 0 holds the events whose time first differs from last_event_time at bit i - 1, counting from the lowest.
+int free_event_head = -1;
+long last_event_time = 0; // time of the last event taken from the queue. No event may be posted before it.
+int cpu_processes[NO_OF_CPUS]; // the process each CPU is running, -1 if the CPU is idle
+int running_cpu = -1; // the CPU whose process is making an access, -1 outside accesses (while processes are created and while the daemons run)
+long cpu_quantum_ends[NO_OF_CPUS]; // when the quantum of each CPU's process is over
+int ready_queue[MAX_PROCESS_COUNT]; // processes waiting for a CPU, in the order they became ready
+int no_of_ready_processes = 0;
+int workload_accesses_left[MAX_PROCESS_COUNT]; // accesses each process makes before it leaves the workload
+int is_process_suspended[MAX_PROCESS_COUNT]; // processes waiting for their swap file reads to complete
+int is_process_exited[MAX_PROCESS_COUNT]; // processes that left the workload. Their memory has been freed.
+int no_of_workload_processes = 0; // processes created or forked so far. Forked children get the next id.
+int no_of_live_processes = 0; // processes that haven't left the workload
+int no_of_workload_accesses = 0;
+long no_of_events = 0; // events taken from the queue
+double event_queue_rate = 0; // events posted and taken per second of wall-clock time, measured after the workload
+int no_of_context_switches = 0;
+int no_of_preemptions = 0; // processes whose quantum ran out while another process was ready
+long cpu_busy_time = 0;
+
+long cycles_by_cause[NO_OF_COST_CAUSES];
+long cpu_cycles_charged = 0; // cycles charged to causes other than swap file reads and writes, which keep a CPU busy
+struct cache caches[NO_OF_CACHE_LEVELS]; // L1, L2 and the LLC, in order
+unsigned long cache_clock = 0; // increased on every cache reference
+int no_of_cache_memory_references[2]; // references of each kind that missed in every level
+int no_of_back_invalidations = 0; // lines invalidated in L1 or L2 because the LLC evicted them
+struct cache fully_associative_llc; // an LLC of the same size with a single set, fed the same lookups and fills. An LLC miss that hits in it is a conflict miss.
+int no_of_llc_conflict_misses[2]; // references of each kind that missed in the LLC only because of the sets their lines map on to
+struct cache uncolored_caches[NO_OF_CACHE_LEVELS]; // a second hierarchy fed the same references, but with each frame at the address of its uncolored frame, to measure conflict misses without page coloring
+struct cache uncolored_fully_associative_llc;
+int no_of_uncolored_llc_conflict_misses[2];
+int no_of_uncolored_back_invalidations = 0;
+
+int next_page_colors[MAX_PROCESS_COUNT]; // how far each process has gone round the colors it may use. Process i starts i colors in, so that processes don't all start on the same color.
+int no_of_page_color_fallbacks = 0; // frames given from another color because every color the process may use was full
+int no_of_frames_given_per_color[NO_OF_PAGE_COLORS]; // frames given by allocate_frame, by color
+int uncolored_frame_numbers[NO_OF_FRAMES]; // the frame first-fit allocation would have given in place of each frame, without page coloring
+
+const char *cost_cause_names[NO_OF_COST_CAUSES] = {"TLB Lookups", "Page Walks", "Data References", "Minor Faults", "Major Faults", "Swap File Reads", "TLB Shootdowns",
+"Shadow Paging", "IOMMU", "Same-Page Merging", "Cross-Process Copies", "Huge Page Copies", "Fork Page Table Copies", "Swap File Writes"};
+
+struct tlb_entry prefetch_buffer[PREFETCH_BUFFER_SIZE];
+struct distance_table_entry distance_table[DISTANCE_TABLE_SIZE];
+int last_tlb_miss_pages[MAX_PROCESS_COUNT]; // page of each process' last TLB miss, -1 if it hasn't missed
+int last_tlb_miss_distances[MAX_PROCESS_COUNT]; // distance between each process' last two TLB misses, 0 if unknown
+int no_of_prefetches = 0; // translations put in the prefetch buffer
+int no_of_useful_prefetches = 0; // prefetched translations that were used by a TLB miss
+int no_of_prefetch_walks = 0; // page walks made by the prefetcher
+
+struct nested_walk_cache_entry nested_walk_cache[NESTED_WALK_CACHE_SIZE];
+int no_of_nested_walks = 0;
+int no_of_nested_walk_references = 0;
+int nested_walk_reference_counts[MAX_NESTED_WALK_REFERENCES + 1]; // number of nested walks that made each number of references
+int no_of_nested_walk_cache_hits = 0;
+int no_of_nested_walk_cache_misses = 0;
+
+struct page_table_entry host_page_tables[MAX_PROCESS_COUNT][HOST_OUTER_PAGE_TABLE_SIZE][NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE]; // indexed by process id. For a guest process, the inner page tables of the host page table, which maps guest-physical frames on to frames.
+
+// Guest processes always get shadow page tables, so that both virtualization modes can be compared in a single run
+struct page_table_entry shadow_page_tables[MAX_PROCESS_COUNT][OUTER_PAGE_TABLE_SIZE][NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE]; // indexed by process id
+int no_of_shadow_walks = 0;
+int no_of_shadow_walk_references = 0;
+int no_of_shadow_page_table_traps = 0;
+int no_of_shadow_page_table_syncs = 0;
+
+struct dma_device dma_devices[NO_OF_DMA_DEVICES];
+struct tlb iotlb; // the IOMMU's TLB. Its entries are tagged with device ids instead of process ids.
+struct invalidation_request invalidation_queue[INVALIDATION_QUEUE_SIZE];
+int invalidation_queue_length = 0;
+int no_of_dma_ios = 0;
+int no_of_failed_dma_ios = 0; // I/Os that found no free frames or I/O virtual pages
+int no_of_dma_accesses = 0;
+int no_of_io_page_walk_references = 0;
+int no_of_iotlb_invalidations = 0;
+int no_of_pinned_frames = 0;
+long iommu_map_cost = 0; // cycles
+long iommu_unmap_cost = 0; // cycles
+
+int no_of_forks = 0;
+int no_of_fork_page_table_references = 0; // page table entries read or written by forks
+int no_of_frames_shared_by_fork = 0;
+int no_of_copy_on_write_faults = 0;
+int no_of_copy_on_write_copies = 0; // frames copied by copy-on-write faults
+int no_of_copy_on_write_reuses = 0; // copy-on-write faults of the last process sharing a frame, which keep the frame
+
+struct shared_memory_segment shared_memory_segments[NO_OF_SHARED_MEMORY_SEGMENTS];
+int shared_memory_attachments[MAX_PROCESS_COUNT][NO_OF_SHARED_MEMORY_SEGMENTS]; // first page each segment is attached at in each process, -1 if it isn't attached
+// The outer page table entries of a process that point to a shared inner page table instead of the process' own inner page table. NULL if they don't.
+struct page_table_entry *shared_inner_page_tables[MAX_PROCESS_COUNT][OUTER_PAGE_TABLE_SIZE];
+int no_of_shared_memory_segments_created = 0;
+int no_of_shared_memory_attachments = 0;
+int no_of_shared_page_table_attachments = 0; // attachments that pointed outer page table entries at shared inner page tables
+int no_of_shared_memory_page_table_writes = 0; // page table entries written by attachments
+int no_of_shared_memory_page_table_writes_saved = 0; // page table entries shared inner page tables didn't need written
+
+int huge_page_daemon_cursor = 0; // the next inner page table the daemon scans, counted across all processes
+int no_of_inner_page_tables_scanned = 0;
+int no_of_huge_page_collapses = 0;
+int no_of_huge_page_splits = 0;
+int no_of_frames_copied = 0; // by huge page collapses
+int no_of_bloat_frames = 0;
+
+int page_table_mode = PAGE_TABLE_MODE_RADIX;
+struct inverted_page_table_entry inverted_page_table[NO_OF_FRAMES];
+int hash_anchor_table[HASH_ANCHOR_TABLE_SIZE]; // index of the first inverted page table entry of each chain, -1 if the chain is empty
+// Every page walk looks the page up in both structures, so that their costs can be compared in a single run.
+int no_of_page_walks = 0;
+int no_of_demand_page_walks = 0; // walks on TLB misses of accesses, not counting the prefetcher's walks or the walk retried after a page fault
+int no_of_radix_walk_references = 0;
+int no_of_inverted_walk_references = 0;
+int no_of_inverted_alias_faults = 0; // inverted page table misses on a shared frame mapped by another process
+int no_of_inverted_zero_frame_reloads = 0; // inverted page table misses on pages mapped on to the zero frame, which isn't a shared frame like the others
+int radix_page_table_footprint = 0; // bytes, measured at the end of the workload
+int populated_radix_page_table_footprint = 0;
+int inverted_page_table_footprint = 0;
+
+struct cuckoo_page_table cuckoo_page_tables[MAX_PROCESS_COUNT][NO_OF_PAGE_SIZES]; // indexed by process id and page size
+struct cuckoo_walk_cache_entry cuckoo_walk_cache[CUCKOO_WALK_CACHE_SIZE];
+int no_of_cuckoo_walk_steps = 0; // dependent memory steps. The ways are probed in parallel, so a probe of every way is a single step.
+int no_of_cuckoo_walk_references = 0;
+int no_of_cuckoo_walk_cache_hits = 0;
+int no_of_cuckoo_walk_cache_misses = 0;
+int no_of_cuckoo_resizes = 0;
+int no_of_cuckoo_resize_stalls = 0; // resizes that had to finish at once because an insertion found no slot
+int no_of_cuckoo_kicks = 0;
+int cuckoo_page_table_footprint = 0;
 
 // FUNCTION DECLARATIONS
 
@@ -112,6 +951,43 @@ void update_page_table(struct PCB *process, int logical_address, int frame_numbe
 void deallocate_memory(struct PCB *process);
 
 void initialize_physical_memory();
+void initialize_zero_frame();
+void reserve_zero_filled_pages(struct PCB *process, int page_number);
+void measure_resident_memory();
+
+void run_ksm_scanner();
+bool ksm_scan_page(struct PCB *process, int page_number);
+bool is_frame_mapped_by_huge_page(int frame_number);
+int ksm_tree_search(struct ksm_tree_node *tree, int *root, int frame_number, int **link);
+void ksm_tree_insert(struct ksm_tree_node *tree, int *size, int *link, int frame_number, int process_id, int page_number);
+void ksm_merge_frame(int frame_number, int ksm_frame_number);
+void rebuild_stable_tree();
+unsigned int checksum_frame(int frame_number);
+
+void initialize_swap();
+int allocate_frame(struct PCB *process);
+int allocate_free_frame(struct PCB *process);
+bool evict_page(int cpu);
+bool swap_out_page(struct PCB *process, int page_number, int cpu);
+int swap_in_page(struct PCB *process, int page_number);
+void load_swapped_page(struct PCB *process, int page_number, int frame_number);
+void fault_around(struct PCB *process, int page_number);
+void read_ahead(struct PCB *process, int page_number);
+int allocate_swap_slot(int cpu);
+bool allocate_swap_cluster(int cpu);
+void free_swap_slot(int swap_slot);
+void write_swap_file(int swap_slot, unsigned char *page);
+void flush_swap_writes();
+int compare_swap_writes(const void *a, const void *b);
+void read_swap_file(int swap_slot, unsigned char *page);
+bool is_swapped_page_in_memory(int swap_slot);
+bool zswap_store(int swap_slot, unsigned char *page);
+bool zswap_load(int swap_slot, unsigned char *page);
+void zswap_invalidate(int swap_slot);
+bool zswap_write_back_oldest();
+bool zswap_allocate_object(int size_class, int *pool_frame_index, int *object_index);
+int lz_compress(unsigned char *input, int input_size, unsigned char *output);
+int lz_decompress(unsigned char *input, int input_size, unsigned char *output, int output_size);
 void initialize_virtual_memory();
 void visualize_physical_memory();
 void visualize_virtual_memory();
@@ -119,6 +995,153 @@ void visualize_inner_page_tables(struct PCB *process);
 void print_memory_specs();
 void display_stats();
 
+struct page_table_entry *get_page_table_entry(struct PCB *process, int page_number);
+int get_process_page_count(struct PCB *process);
+bool is_frame_free(int frame_number);
+int find_free_frame_block(int no_of_frames, int alignment);
+void claim_frame(int frame_number, struct PCB *process);
+void release_frame(int frame_number);
+void copy_frame(int destination_frame_number, int source_frame_number);
+void share_frame(int frame_number);
+void reverse_map_insert(int frame_number, int process_id, int page_number);
+void reverse_map_remove(int frame_number, int process_id, int page_number);
+int get_reverse_map_count(int frame_number);
+
+void initialize_tlb(struct tlb *tlb);
+struct tlb_entry *tlb_lookup(struct tlb *tlb, int process_id, int page_number);
+void tlb_insert(struct tlb *tlb, struct tlb_entry entry);
+void tlb_invalidate(struct tlb *tlb, int process_id, int page_number, int no_of_pages);
+int get_tlb_reach(struct tlb *tlb);
+void tlb_shootdown(int process_id, int page_number, int no_of_pages);
+bool is_page_in_tlb_entries(struct tlb_entry *entries, int no_of_entries, int process_id, int page_number);
+void coalesce_translation(struct PCB *process, int page_number, struct tlb_entry *translation);
+
+void build_range_table(struct PCB *process);
+bool walk_range_table(struct PCB *process, int page_number, struct range_table_entry *range);
+struct range_table_entry *get_direct_segment(struct PCB *process);
+struct range_tlb_entry *range_tlb_lookup(int process_id, int page_number);
+void range_tlb_insert(int process_id, struct range_table_entry range);
+void range_tlb_invalidate(int process_id, int page_number);
+
+void initialize_tlb_prefetcher();
+bool prefetch_buffer_take(int process_id, int page_number, struct tlb_entry *translation);
+void prefetch_translation(struct PCB *process, int page_number);
+void train_tlb_prefetcher(struct PCB *process, int page_number);
+void update_distance_table(int distance, int next_distance);
+struct distance_table_entry *find_distance_table_entry(int distance);
+
+void initialize_host_page_table(struct PCB *process);
+struct page_table_entry *get_host_page_table_entry(struct PCB *process, int guest_frame_number);
+int allocate_guest_frame(struct PCB *process, int frame_number);
+void free_guest_frame(struct PCB *process, int guest_frame_number);
+int translate_guest_frame(struct PCB *process, int guest_frame_number, int *no_of_references);
+void nested_walk_cache_invalidate(int process_id, int guest_frame_number);
+bool walk_nested_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references);
+
+void initialize_shadow_page_table(struct PCB *process);
+void trap_guest_page_table_write(struct PCB *process, int page_number);
+bool walk_shadow_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references);
+
+void initialize_iommu();
+struct page_table_entry *get_io_page_table_entry(int device_id, int io_page_number);
+int dma_map(int device_id, struct PCB *process, int no_of_pages);
+void dma_unmap(int device_id, int io_page_number, int no_of_pages);
+int iommu_translate(int device_id, int io_virtual_address);
+void flush_invalidation_queue();
+void run_dma_io(struct PCB *process);
+
+int open_shared_memory_segment(const char *name, struct PCB *process);
+int attach_shared_memory_segment(struct PCB *process, int segment_id, int page_number);
+void destroy_shared_memory_segment(int segment_id);
+void detach_shared_memory_segment(struct PCB *process, int segment_id);
+int find_free_virtual_pages(struct PCB *process, int no_of_pages, int alignment);
+int get_shared_memory_segment(struct PCB *process, int page_number);
+int generate_shared_memory_logical_address(struct PCB *process);
+
+struct PCB *fork_process(struct PCB *parent, int process_number);
+void write_protect_page(struct PCB *process, int page_number);
+int handle_copy_on_write_fault(struct PCB *process, int page_number);
+
+bool set_page_table_entry(struct PCB *process, int page_number, int frame_number);
+bool walk_page_table(struct PCB *process, int page_number, struct tlb_entry *translation);
+bool walk_radix_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references);
+int access_memory(struct PCB *process, int logical_address, bool is_write);
+int load_memory(struct PCB *process, int logical_address, unsigned char *buffer, int length);
+int store_memory(struct PCB *process, int logical_address, unsigned char *buffer, int length);
+int copy_memory(struct PCB *process, int logical_address, unsigned char *buffer, int length, bool is_write);
+void copy_physical_run(int physical_address, unsigned char *buffer, int length, bool is_write);
+int copy_process_memory(struct PCB *destination, struct memory_vector *destination_vectors, int no_of_destination_vectors, struct PCB *source, struct memory_vector *source_vectors, int no_of_source_vectors);
+bool will_access_fault(struct PCB *process, int logical_address, bool is_write);
+long get_process_copy_cost();
+int remap_pages(struct PCB *source, int source_page_number, struct PCB *destination, int destination_page_number, int no_of_pages);
+void pass_message(struct PCB *process, int num_of_processes);
+void copy_message(struct PCB *process, int num_of_processes);
+int translate_range(struct PCB *process, int logical_address, int length, struct physical_extent *extents, int max_extents, int *no_of_bytes_translated);
+void run_scatter_gather_io(struct PCB *process);
+int handle_page_fault(struct PCB *process, int page_number);
+void unmap_page(struct PCB *process, int page_number);
+void run_workload(int num_of_processes);
+int generate_workload_logical_address(struct PCB *process, int no_of_pages);
+void run_workload_step(struct PCB *process);
+void exit_process(int process_id);
+long submit_swap_file_reads(int no_of_reads);
+void charge_cycles(int cause, long cycles);
+long get_access_path_cycles();
+long get_total_cycles();
+void add_page_walk_references(int no_of_references);
+void initialize_caches();
+void initialize_cache(struct cache *cache, const char *name, int size, int associativity, int hit_cost);
+bool cache_lookup(struct cache *cache, int line_address);
+int cache_insert(struct cache *cache, int line_address);
+bool cache_remove(struct cache *cache, int line_address);
+long access_cache_hierarchy(int physical_address, int kind, long memory_cost);
+int reference_cache_hierarchy(struct cache *levels, struct cache *fully_associative_llc, int *conflict_misses, int *back_invalidations, int line_address, int kind);
+int get_frame_color(int frame_number);
+int find_free_frame_of_color(int color);
+int find_colored_free_frame(struct PCB *process);
+void record_uncolored_frame(int frame_number);
+int get_page_table_entry_address(struct PCB *process, int page_number, bool is_outer);
+void reference_page_table_entry(struct PCB *process, int page_number, bool is_outer);
+void initialize_event_queue();
+void post_event(long time, int type, int id);
+bool take_event(struct event *event);
+void measure_event_queue_rate();
+int get_event_bucket(long time);
+void handle_event(struct event *event);
+void handle_access_event(int cpu);
+void make_process_ready(int process_id);
+void dispatch_process(int cpu);
+int pick_next_process();
+
+bool collapse_huge_page(struct PCB *process, int inner_page_table_no);
+void split_huge_page(struct PCB *process, int inner_page_table_no);
+void map_huge_page(struct PCB *process, int inner_page_table_no);
+void run_huge_page_daemon();
+
+void select_page_table_mode();
+void initialize_inverted_page_table();
+int hash_page(int process_id, int page_number);
+void inverted_page_table_insert(int frame_number, int process_id, int page_number);
+void inverted_page_table_remove(int frame_number);
+bool walk_inverted_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references);
+
+void initialize_cuckoo_page_table(struct cuckoo_page_table *table);
+void free_cuckoo_page_table(struct cuckoo_page_table *table);
+int cuckoo_hash(int way, int page_number, int way_size);
+struct cuckoo_page_table_entry *get_cuckoo_slot(struct cuckoo_page_table *table, int way, int page_number);
+bool cuckoo_place(struct cuckoo_page_table *table, struct cuckoo_page_table_entry *entry);
+void cuckoo_place_or_grow(struct cuckoo_page_table *table, struct cuckoo_page_table_entry entry);
+void start_cuckoo_resize(struct cuckoo_page_table *table);
+void migrate_cuckoo_slots(struct cuckoo_page_table *table, int no_of_slots);
+void finish_cuckoo_resize(struct cuckoo_page_table *table);
+void cuckoo_page_table_insert(struct cuckoo_page_table *table, int page_number, int frame_number);
+void cuckoo_page_table_remove(struct cuckoo_page_table *table, int page_number);
+struct cuckoo_page_table_entry *cuckoo_page_table_lookup(struct cuckoo_page_table *table, int page_number);
+int cuckoo_walk_cache_lookup(struct PCB *process, int inner_page_table_no, int *no_of_references, int *no_of_steps);
+void cuckoo_walk_cache_invalidate(int process_id, int inner_page_table_no);
+bool walk_cuckoo_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references);
+void measure_page_table_footprint();
+
 
 // --- MAIN ---
 int main () {
@@ -133,9 +1156,20 @@ int main () {
     print_memory_specs();
 
     initialize_physical_memory();
+    initialize_zero_frame();
+    initialize_swap();
 
     initialize_virtual_memory();
 
+    select_page_table_mode();
+    initialize_inverted_page_table();
+
+    initialize_tlb(&tlb);
+    initialize_tlb(&baseline_tlb);
+    initialize_tlb_prefetcher();
+    initialize_iommu();
+    initialize_caches();
+
     int num_of_processes;
 
     printf("\nHow many processes do you want to create? Maximum is 64\n");
@@ -168,12 +1202,17 @@ int main () {
 
     }
 
+    run_workload(num_of_processes);
+
     // visualize_physical_memory();
     visualize_physical_memory();
     visualize_virtual_memory();
 
-    for (int i =0; i<num_of_processes; i++) {
-        deallocate_memory(processes[i]);
+    // Processes forked during the workload are deallocated too. Processes that left the workload already have been.
+    for (int i = 0; i < MAX_PROCESS_COUNT; i++) {
+        if (processes[i] != NULL && is_process_exited[i] == 0) {
+            deallocate_memory(processes[i]);
+        }
     }
 
 
@@ -184,6 +1223,12 @@ int main () {
     // Free allocated memory for each process when done
     for (int i = 0; i < MAX_PROCESS_COUNT; i++) {
         free(processes[i]);
+        for (int j = 0; j < NO_OF_PAGE_SIZES; j++) {
+            free_cuckoo_page_table(&cuckoo_page_tables[i][j]);
+        }
+    }
+    if (swap_file != NULL) {
+        fclose(swap_file);
     }
 
     display_stats();
@@ -217,7 +1262,8 @@ void translate_logical_address_to_physical(int logical_address, struct PCB *proc
 
     // assign process to page(s) in virtual memory.
     int required_no_of_pages = (int)ceil((double)process->size_in_memory / PAGE_SIZE );
-    for (int i = page_number; i < page_number + required_no_of_pages; i++) {
+    process->start_page_number = page_number;
+    for (int i = page_number; i < page_number + required_no_of_pages && i < NO_OF_PAGES; i++) {
         for (int j = 0; j < FRAME_SIZE; j++) {
             virtual_memory[i][offset].process = *process;
         }
@@ -231,7 +1277,11 @@ void translate_logical_address_to_physical(int logical_address, struct PCB *proc
 
     struct page_table_entry pte = process->inner_page_tables[inner_page_table_no][inner_page_table_offset];
 
-    if (pte.frame_number == -1) {
+    if (pte.frame_number == -1 && ZERO_FILL_ON_DEMAND) {
+        reserve_zero_filled_pages(process, page_number);
+    }
+
+    else if (pte.frame_number == -1) {
 
         no_of_page_faults++; // increase number of page faults by 1.
         printf("Page Fault (Page entry has not yet been assigned a frame).\n");
@@ -240,7 +1290,9 @@ void translate_logical_address_to_physical(int logical_address, struct PCB *proc
         int frame_number = allocate_memory(process, offset);
 
         // update page table after memory allocation
-        update_page_table(process, logical_address, frame_number);
+        if (frame_number != -1) {
+            update_page_table(process, logical_address, frame_number);
+        }
     }
 
     else {
@@ -328,6 +1380,8 @@ int allocate_memory(struct PCB *process, int offset) {
             for (int j = 0; j < FRAME_SIZE; j++) {
                 physical_memory[i][offset] = *process;
             }
+            memset(frame_contents[i], 0, FRAME_SIZE);
+            frame_reference_counts[i] = 1;
         }
 
         printf("Memory allocated successfully at frame %d for process with ID %d. Process is occupying %d frames.\n", start_frame, 
@@ -355,13 +1409,38 @@ void initialize_process_page_tables(struct PCB *process) {
         for (int j = 0; j < NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; j++) {
             process->inner_page_tables[i][j].frame_number = -1;
             process->inner_page_tables[i][j].valid = 0;
+            process->inner_page_tables[i][j].writable = 0;
+            process->inner_page_tables[i][j].swap_slot = -1;
+            process->inner_page_tables[i][j].accessed = 0;
+            process->inner_page_tables[i][j].dirty = 0;
         }
+        process->huge_pages[i] = 0;
+        shared_inner_page_tables[process->id][i] = NULL;
+    }
+
+    for (int i = 0; i < NO_OF_SHARED_MEMORY_SEGMENTS; i++) {
+        shared_memory_attachments[process->id][i] = -1;
+    }
+
+    for (int i = 0; i < NO_OF_PAGES; i++) {
+        is_faulted_around[process->id][i] = 0;
+        is_read_ahead[process->id][i] = 0;
+    }
+    readahead_windows[process->id] = 0;
+    last_swap_in_faults[process->id] = -1;
+    readahead_next_pages[process->id] = -1;
+
+    initialize_host_page_table(process);
+    initialize_shadow_page_table(process);
+
+    for (int i = 0; i < NO_OF_PAGE_SIZES; i++) {
+        initialize_cuckoo_page_table(&cuckoo_page_tables[process->id][i]);
     }
 }
 
 
 /**
- * @brief Update the process's page table. This is done after allocating it memory.
+ * @brief Update the process's page table. This is done after allocating it memory. Since the process occupies consecutive pages and consecutive frames, every page of the process gets an entry, mapping on to the frame at the same distance from the starting frame.
  * 
  * @param process The process whose page table is to be updated.
  * @param logical_address The logical address generated when the process was recently stored in physical memory.
@@ -371,11 +1450,10 @@ void update_page_table(struct PCB *process, int logical_address, int frame_numbe
     int page_number = logical_address / PAGE_SIZE;
     int offset = logical_address % PAGE_SIZE;
 
-    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
-    int inner_page_table_offset = page_number % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
-
-    process->inner_page_tables[inner_page_table_no][inner_page_table_offset].frame_number = frame_number;
-    process->inner_page_tables[inner_page_table_no][inner_page_table_offset].valid = 1;
+    int no_of_pages = get_process_page_count(process);
+    for (int i = 0; i < no_of_pages; i++) {
+        set_page_table_entry(process, page_number + i, frame_number + i);
+    }
 
     printf("Process %d has been assigned to page %d and offset %d.\n\n", process->id, page_number, offset);
 }
@@ -412,6 +1490,7 @@ void initialize_physical_memory() {
         for (int j = 0; j < FRAME_SIZE; j++) {
             physical_memory[i][j].id = -1;
         }
+        reverse_map_heads[i] = -1;
     }
 
     printf("Physical memory initialized.\n\n");
@@ -420,6 +1499,48 @@ void initialize_physical_memory() {
 }
 
 
+/**
+ * @brief Set aside the zero frame, which every page that hasn't been written yet maps on to, if zero-fill-on-demand is on. It holds a reference of its own, so it's never freed.
+ */
+void initialize_zero_frame() {
+    if (!ZERO_FILL_ON_DEMAND) {
+        return;
+    }
+
+    zero_frame_number = find_free_frame_block(1, 1);
+    for (int j = 0; j < FRAME_SIZE; j++) {
+        physical_memory[zero_frame_number][j].id = ZERO_FRAME_OWNER_ID;
+    }
+    frame_reference_counts[zero_frame_number] = 1;
+    available_physical_memory -= FRAME_SIZE;
+
+    printf("Frame %d is the zero frame.\n\n", zero_frame_number);
+}
+
+
+/**
+ * @brief Reserve the pages a process was granted without allocating frames for them. Every page is mapped read-only on to the zero frame, so reads see zeros, and the first write to a page allocates its frame. The granted memory is still taken off the available physical memory, so that the frames are there when the pages are written.
+ * 
+ * @param process The process whose pages are to be reserved.
+ * @param page_number The first page of the process.
+ */
+void reserve_zero_filled_pages(struct PCB *process, int page_number) {
+    int no_of_pages = get_process_page_count(process);
+
+    for (int i = 0; i < no_of_pages; i++) {
+        share_frame(zero_frame_number);
+        set_page_table_entry(process, page_number + i, zero_frame_number);
+        write_protect_page(process, page_number + i);
+    }
+
+    available_physical_memory -= process->size_in_memory;
+    no_of_pages_reserved += no_of_pages;
+
+    printf("Pages %d-%d of process %d are mapped on to the zero frame until they are written. %d bytes of physical memory remaining.\n\n", page_number,
+    page_number + no_of_pages - 1, process->id, available_physical_memory);
+}
+
+
 /**
  * @brief Visualize physical memory in a tabular format
  * 
@@ -492,9 +1613,14 @@ struct PCB create_process(int process_number) {
     processes[process_number]->id = process_number;
     processes[process_number]->size = process_size;
     processes[process_number]->size_in_memory = 0;
+    processes[process_number]->start_page_number = -1;
+    processes[process_number]->is_guest = rand() % 100 < GUEST_PROCESS_PERCENT;
 
     printf("\nProcess ID: %d\n", processes[process_number]->id);
     printf("Process Size: %d bytes\n", processes[process_number]->size);
+    if (processes[process_number]->is_guest) {
+        printf("Process %d is a guest of a virtual machine.\n", processes[process_number]->id);
+    }
 
     return *processes[process_number];
 }
@@ -606,36 +1732,49 @@ void deallocate_memory(struct PCB *process) {
     // visualize_inner_page_tables(process);
     int frame_number = find_process_frame_number(process);
     printf("PROCESS %d frame number is %d\n", process->id, frame_number);
-    int no_of_frames = (int)ceil((double)process->size_in_memory / FRAME_SIZE);
+    int no_of_pages = get_process_page_count(process);
 
     // Free physical memory of the process
     // first check if the process is in physcial memory.
     if (frame_number != -1) {
         printf("Memory access successful! Page hit recorded.\n");
         no_of_page_hits+=1;
-        for (int i = frame_number; i < frame_number + no_of_frames; i++) {
-            for (int j = 0; j < FRAME_SIZE; j++) {
-                if (physical_memory[i][j].id != -1) {
+    }
+
+    for (int i = 0; i < NO_OF_SHARED_MEMORY_SEGMENTS; i++) {
+        if (shared_memory_attachments[process->id][i] != -1) {
+            detach_shared_memory_segment(process, i);
+        }
+    }
+
+    // A forked child shares its parent's pages in virtual memory, so its pages are found from its PCB rather than by searching virtual memory.
+    int page_number = process->start_page_number;
+    if (page_number != -1) {
+        // The process' frames are not necessarily consecutive anymore (pages may have been faulted in or collapsed into huge pages), so every mapped page is freed individually. Frames shared with another process stay in memory.
+        for (int i = 0; i < OUTER_PAGE_TABLE_SIZE; i++) {
+            for (int j = 0; j < NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; j++) {
+                if (process->inner_page_tables[i][j].valid == 1) {
                     // Free physical memory by marking the frame as empty
-                    physical_memory[i][j].id = -1;
+                    release_frame(process->inner_page_tables[i][j].frame_number);
+                    set_page_table_entry(process, i * NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE + j, -1);
+                }
+                else if (process->inner_page_tables[i][j].swap_slot != -1) {
+                    free_swap_slot(process->inner_page_tables[i][j].swap_slot);
                 }
             }
         }
+        initialize_process_page_tables(process);
+        tlb_shootdown(process->id, 0, NO_OF_PAGES);
+
         available_physical_memory += process->size_in_memory;
         process->size_in_memory = 0;
+        process->start_page_number = -1;
         printf("Memory has been successfully deallocated! Process %d is no longer in memory. Physical memory remaining is now %d\n\n", process->id, available_physical_memory);
 
-        // Set process's page's number's corresponding frame to -1.
-        int page_number = find_process_page_number(process);
-        int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
-        int inner_page_table_offset = page_number % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
-        process->inner_page_tables[inner_page_table_no][inner_page_table_offset].frame_number = -1;
-        process->inner_page_tables[inner_page_table_no][inner_page_table_offset].valid = 0;
-
         // Free virtual memory of the process
-        for (int i = page_number; i < page_number + no_of_frames; i++) {
+        for (int i = page_number; i < page_number + no_of_pages; i++) {
             for (int j = 0; j < PAGE_SIZE; j++) {
-                if (virtual_memory[i][j].process.id != -1) {
+                if (virtual_memory[i][j].process.id == process->id) {
                     // Free virtual memory by marking the page as empty
                     virtual_memory[i][j].process.id = -1;
                 }
@@ -643,8 +1782,6 @@ void deallocate_memory(struct PCB *process) {
         }
     }
 
-    
-
 }
 
 
@@ -690,4 +1827,5306 @@ void display_stats() {
     printf("\nSIMULATION STATS\n");
     printf("Page Faults: %d\n", no_of_page_faults);
     printf("Page Hits: %d\n", no_of_page_hits);
-}
\ No newline at end of file
+
+    printf("Memory Accesses: %d\n", no_of_memory_accesses);
+    printf("TLB Hits: %d\n", tlb.hits);
+    printf("TLB Misses: %d\n", tlb.misses);
+    printf("Page Walk References: %d\n", no_of_page_walk_references);
+
+    printf("\nPAGE TABLE STATS\n");
+    printf("Page Table Walked: %s\n", page_table_mode == PAGE_TABLE_MODE_INVERTED ? "inverted" : page_table_mode == PAGE_TABLE_MODE_CUCKOO ? "cuckoo hashed" : "two-level");
+    printf("Page Walks: %d\n", no_of_page_walks);
+    if (no_of_page_walks > 0) {
+        printf("Two-Level Page Table References Per Walk: %.2f\n", (double)no_of_radix_walk_references / no_of_page_walks);
+        printf("Inverted Page Table References Per Walk (hash anchor table included): %.2f\n", (double)no_of_inverted_walk_references / no_of_page_walks);
+    }
+    printf("Two-Level Page Table Footprint: %d bytes (%d bytes counting only populated inner page tables)\n", radix_page_table_footprint, populated_radix_page_table_footprint);
+    printf("Inverted Page Table Footprint: %d bytes\n", inverted_page_table_footprint);
+
+    printf("\nNESTED PAGING STATS\n");
+    printf("Nested Walks (two-level walks of guest processes): %d\n", no_of_nested_walks);
+    if (no_of_nested_walks > 0) {
+        printf("References Per Nested Walk: %.2f (at most %d)\n", (double)no_of_nested_walk_references / no_of_nested_walks, MAX_NESTED_WALK_REFERENCES);
+        for (int i = 0; i <= MAX_NESTED_WALK_REFERENCES; i++) {
+            if (nested_walk_reference_counts[i] > 0) {
+                printf("  Walks With %d References: %d\n", i, nested_walk_reference_counts[i]);
+            }
+        }
+    }
+    printf("Nested Walk Cache Hits: %d\n", no_of_nested_walk_cache_hits);
+    printf("Nested Walk Cache Misses: %d\n", no_of_nested_walk_cache_misses);
+
+    printf("\nSHADOW PAGING STATS\n");
+    printf("Virtualization Mode: %s\n", VIRTUALIZATION_MODE == VIRTUALIZATION_MODE_SHADOW ? "shadow paging" : "nested paging");
+    printf("Shadow Walks: %d (%d references)\n", no_of_shadow_walks, no_of_shadow_walk_references);
+    printf("Guest Page Table Writes Trapped: %d\n", no_of_shadow_page_table_traps);
+    printf("Shadow Page Table Entries Synchronized: %d\n", no_of_shadow_page_table_syncs);
+    long nested_paging_cost = (long)no_of_nested_walk_references * PAGE_WALK_REFERENCE_COST;
+    long shadow_paging_cost = (long)no_of_shadow_walk_references * PAGE_WALK_REFERENCE_COST + (long)no_of_shadow_page_table_traps * SHADOW_PAGE_TABLE_TRAP_COST
+    + (long)no_of_shadow_page_table_syncs * SHADOW_PAGE_TABLE_SYNC_COST;
+    printf("Nested Paging Cost: %ld cycles (walks)\n", nested_paging_cost);
+    printf("Shadow Paging Cost: %ld cycles (walks %ld, traps %ld, synchronization %ld)\n", shadow_paging_cost, (long)no_of_shadow_walk_references * PAGE_WALK_REFERENCE_COST,
+    (long)no_of_shadow_page_table_traps * SHADOW_PAGE_TABLE_TRAP_COST, (long)no_of_shadow_page_table_syncs * SHADOW_PAGE_TABLE_SYNC_COST);
+    if (no_of_nested_walks > 0 || no_of_shadow_page_table_traps > 0) {
+        printf("Cheaper For This Workload: %s\n", shadow_paging_cost < nested_paging_cost ? "shadow paging" : "nested paging");
+    }
+
+    printf("\nIOMMU STATS\n");
+    printf("Unmapping Mode: %s\n", IOMMU_UNMAP_MODE == IOMMU_UNMAP_STRICT ? "strict" : "lazy");
+    printf("DMA I/Os: %d (%d failed for lack of frames or I/O virtual pages)\n", no_of_dma_ios, no_of_failed_dma_ios);
+    printf("Frames Pinned For DMA: %d\n", no_of_pinned_frames);
+    printf("Device Accesses: %d\n", no_of_dma_accesses);
+    printf("IOTLB Hits: %d\n", iotlb.hits);
+    printf("IOTLB Misses: %d (%d I/O page table references)\n", iotlb.misses, no_of_io_page_walk_references);
+    printf("IOTLB Invalidations: %d\n", no_of_iotlb_invalidations);
+    if (no_of_dma_ios > 0) {
+        printf("Map Cost Per I/O: %.1f cycles\n", (double)iommu_map_cost / no_of_dma_ios);
+        printf("Unmap Cost Per I/O: %.1f cycles\n", (double)iommu_unmap_cost / no_of_dma_ios);
+    }
+
+    printf("\nCOPY-ON-WRITE FORK STATS\n");
+    printf("Forks: %d\n", no_of_forks);
+    if (no_of_forks > 0) {
+        printf("Page Table Entries Read Or Written Per Fork: %.1f (%.1f frames shared instead of copied)\n", (double)no_of_fork_page_table_references / no_of_forks,
+        (double)no_of_frames_shared_by_fork / no_of_forks);
+    }
+    printf("Frames Shared By Forks: %d\n", no_of_frames_shared_by_fork);
+    printf("Copy-On-Write Faults: %d (%d frames copied, %d kept by the last process sharing them)\n", no_of_copy_on_write_faults, no_of_copy_on_write_copies, no_of_copy_on_write_reuses);
+    printf("Frame Copies Avoided: %d\n", no_of_frames_shared_by_fork - no_of_copy_on_write_copies);
+    printf("Inverted Page Table Alias Faults (shared frames): %d (and %d reloads of the zero frame)\n", no_of_inverted_alias_faults, no_of_inverted_zero_frame_reloads);
+
+    printf("\nZERO-FILL-ON-DEMAND STATS\n");
+    printf("Zero-Fill-On-Demand: %s\n", ZERO_FILL_ON_DEMAND ? "on" : "off");
+    printf("Granted Pages Mapped On To The Zero Frame: %d\n", no_of_pages_reserved);
+    printf("Zero-Fill Faults (frames allocated on first write): %d\n", no_of_zero_fill_faults);
+    printf("Pages Mapped On To The Zero Frame When The First Process Exits: %d\n", no_of_zero_frame_mappings);
+    printf("Resident Frames When The First Process Exits: %d (%d bytes)\n", no_of_resident_frames, no_of_resident_frames * FRAME_SIZE);
+
+    printf("\nSAME-PAGE MERGING STATS\n");
+    printf("Full Scans: %d\n", no_of_ksm_full_scans);
+    printf("Pages Scanned: %d\n", no_of_ksm_pages_scanned);
+    printf("Pages Merged: %d (%d frames freed)\n", no_of_ksm_merges, no_of_ksm_frames_freed);
+    printf("Pages Unmerged By Writes: %d\n", no_of_ksm_unmerges);
+    long ksm_cost = ksm_bytes_hashed * KSM_HASH_COST_PER_BYTE + ksm_bytes_compared * KSM_COMPARE_COST_PER_BYTE;
+    printf("CPU Time: %ld cycles (%ld bytes checksummed, %ld bytes compared)\n", ksm_cost, ksm_bytes_hashed, ksm_bytes_compared);
+    if (no_of_ksm_frames_freed > 0) {
+        printf("Cycles Per Frame Freed: %.1f\n", (double)ksm_cost / no_of_ksm_frames_freed);
+    }
+
+    printf("\nLOAD/STORE STATS\n");
+    printf("Bytes Loaded: %ld\n", no_of_bytes_loaded);
+    printf("Bytes Stored: %ld\n", no_of_bytes_stored);
+    printf("Physically Contiguous Runs Copied: %d\n", no_of_physical_runs_copied);
+
+    printf("\nCROSS-PROCESS COPY STATS\n");
+    printf("Copies: %d (%ld bytes)\n", no_of_process_copies, no_of_bytes_copied_between_processes);
+    printf("Pages Translated: %d\n", no_of_process_copy_pages_translated);
+    printf("Physically Contiguous Runs Copied: %d\n", no_of_process_copy_runs);
+    if (no_of_process_copy_runs > 0) {
+        printf("Bytes Per memcpy: %.1f\n", (double)no_of_bytes_copied_between_processes / no_of_process_copy_runs);
+    }
+    long process_copy_cost = get_process_copy_cost();
+    printf("Copy Cost: %ld cycles", process_copy_cost);
+    if (no_of_bytes_copied_between_processes > 0) {
+        printf(" (%.2f cycles per byte)", (double)process_copy_cost / no_of_bytes_copied_between_processes);
+    }
+    printf("\n");
+
+    printf("\nZERO-COPY REMAPPING STATS\n");
+    printf("Remaps: %d (%d pages)\n", no_of_remaps, no_of_pages_remapped);
+    printf("Shared Pages Remapped Copy-On-Write: %d\n", no_of_shared_pages_remapped);
+    printf("Shared Memory Pages Copied Instead: %d\n", no_of_pages_copied_by_remaps);
+    for (int i = 0; i < NO_OF_MESSAGE_SIZES; i++) {
+        if (no_of_messages[i] > 0) {
+            printf("%d-Page Messages: %d (copy %.1f cycles, remap %.1f cycles per message)\n", 1 << i, no_of_messages[i],
+            (double)message_copy_cost[i] / no_of_messages[i], (double)message_remap_cost[i] / no_of_messages[i]);
+        }
+    }
+
+    printf("\nSCATTER-GATHER I/O STATS\n");
+    printf("I/Os: %d (%d scatter-gather lists)\n", no_of_scatter_gather_ios, no_of_scatter_gather_lists);
+    printf("Pages Translated: %d\n", no_of_scatter_gather_pages);
+    printf("Extents: %d", no_of_scatter_gather_extents);
+    if (no_of_scatter_gather_extents > 0) {
+        printf(" (%.2f pages per extent)", (double)no_of_scatter_gather_pages / no_of_scatter_gather_extents);
+    }
+    printf("\n");
+    // a walk per page would walk each page it stops at twice too: once before the page is faulted in and once after
+    printf("Translation References: %d (a page table walk per page would take %d)\n", no_of_range_translation_references, (no_of_scatter_gather_pages + no_of_range_translation_faults) * 2);
+    printf("Pages Faulted In: %d\n", no_of_range_translation_faults);
+
+    printf("\nSWAP STATS\n");
+    printf("Compressed Pool: %s\n", ZSWAP_ENABLED ? "on" : "off");
+    printf("Evictions: %d (%d of dirty pages)\n", no_of_evictions, no_of_dirty_evictions);
+    printf("Swap-Ins: %d\n", no_of_swap_ins);
+    printf("Pages Stored In The Pool: %d (%d didn't compress well enough)\n", no_of_zswap_stores, no_of_zswap_rejections);
+    if (zswap_compressed_bytes > 0) {
+        printf("Compression Ratio: %.2f (%ld bytes into %ld bytes)\n", (double)zswap_uncompressed_bytes / zswap_compressed_bytes, zswap_uncompressed_bytes, zswap_compressed_bytes);
+    }
+    if (no_of_swap_ins > 0) {
+        printf("Pool Hit Rate: %.1f%% of swap-ins\n", 100.0 * no_of_zswap_loads / no_of_swap_ins);
+    }
+    printf("Pages Written Back From The Pool: %d\n", no_of_zswap_writebacks);
+    printf("Swap File Writes: %d pages in %d vectored writes", no_of_swap_file_writes, no_of_swap_write_ios);
+    if (no_of_swap_write_ios > 0) {
+        printf(" (%.2f pages per write)", (double)no_of_swap_file_writes / no_of_swap_write_ios);
+    }
+    printf("\n");
+    printf("Swap Clusters Allocated: %d of %d slots each (%d slots allocated outside a cluster)\n", no_of_swap_clusters_allocated, SWAP_CLUSTER_SIZE, no_of_swap_slot_fallbacks);
+    printf("Swap File Reads Served By The Write Batch: %d\n", no_of_swap_batch_hits);
+    printf("Swap File Reads: %d\n", no_of_swap_file_reads);
+    printf("Swapped Out Pages Loaded: %d (%d from the pool, %d from the write batch, %d from the swap file), faults and readahead included\n", no_of_zswap_loads + no_of_swap_batch_hits + no_of_swap_file_reads,
+    no_of_zswap_loads, no_of_swap_batch_hits, no_of_swap_file_reads);
+    printf("Disk I/O Avoided By The Pool: %d writes, %d reads\n", no_of_zswap_stores - no_of_zswap_writebacks, no_of_zswap_loads);
+
+    printf("\nFAULT-AROUND AND READAHEAD STATS\n");
+    printf("Fault-Around: %s\n", FAULT_AROUND ? "on" : "off");
+    printf("Pages Mapped By Fault-Around: %d (%d accessed without a fault, %d unmapped first)\n", no_of_pages_faulted_around, no_of_fault_around_hits, no_of_fault_around_pages_wasted);
+    printf("Readahead Window: %d to %d pages\n", READAHEAD_INITIAL_WINDOW, READAHEAD_MAX_WINDOW);
+    printf("Pages Read Ahead: %d\n", no_of_pages_read_ahead);
+    if (no_of_pages_read_ahead > 0) {
+        printf("Readahead Hit Rate: %.1f%% (%d pages wasted)\n", 100.0 * no_of_readahead_hits / no_of_pages_read_ahead, no_of_readahead_pages_wasted);
+    }
+
+    printf("\nASYNCHRONOUS FAULT STATS\n");
+    printf("Asynchronous Faults: %s (%d I/O workers)\n", ASYNC_FAULTS ? "on" : "off", NO_OF_IO_WORKERS);
+    printf("Workload Steps That Read The Swap File: %d (%d processes suspended)\n", no_of_major_faults, no_of_process_suspensions);
+    printf("CPU Time Spent Waiting For Reads: %ld cycles\n", cpu_io_wait_time);
+    if (simulated_time > 0) {
+        printf("I/O Worker Utilization: %.1f%%\n", 100.0 * io_worker_busy_time / ((double)NO_OF_IO_WORKERS * simulated_time));
+    }
+
+    printf("\nCACHE STATS\n");
+    printf("Cache Policy: %s (%d-byte lines)\n", CACHE_POLICY == CACHE_POLICY_EXCLUSIVE ? "exclusive" : "inclusive", CACHE_LINE_SIZE);
+    for (int i = 0; i < NO_OF_CACHE_LEVELS; i++) {
+        struct cache *cache = &caches[i];
+        printf("%s: %d bytes, %d-way, %d cycles\n", cache->name, cache->no_of_sets * cache->associativity * CACHE_LINE_SIZE, cache->associativity, cache->hit_cost);
+        int data_lookups = cache->hits[CACHE_REFERENCE_DATA] + cache->misses[CACHE_REFERENCE_DATA];
+        int page_table_lookups = cache->hits[CACHE_REFERENCE_PAGE_TABLE] + cache->misses[CACHE_REFERENCE_PAGE_TABLE];
+        if (data_lookups > 0) {
+            printf("%s Data Hit Rate: %.1f%% (%d of %d)\n", cache->name, 100.0 * cache->hits[CACHE_REFERENCE_DATA] / data_lookups, cache->hits[CACHE_REFERENCE_DATA], data_lookups);
+        }
+        if (page_table_lookups > 0) {
+            printf("%s Page Table Entry Hit Rate: %.1f%% (%d of %d)\n", cache->name, 100.0 * cache->hits[CACHE_REFERENCE_PAGE_TABLE] / page_table_lookups, cache->hits[CACHE_REFERENCE_PAGE_TABLE],
+            page_table_lookups);
+        }
+    }
+    printf("Memory References: %d data, %d page table entries\n", no_of_cache_memory_references[CACHE_REFERENCE_DATA], no_of_cache_memory_references[CACHE_REFERENCE_PAGE_TABLE]);
+    if (CACHE_POLICY == CACHE_POLICY_INCLUSIVE) {
+        printf("Back-Invalidations: %d\n", no_of_back_invalidations);
+    }
+    printf("LLC Conflict Misses: %d data, %d page table entries (%d and %d without page coloring)\n", no_of_llc_conflict_misses[CACHE_REFERENCE_DATA], no_of_llc_conflict_misses[CACHE_REFERENCE_PAGE_TABLE],
+    no_of_uncolored_llc_conflict_misses[CACHE_REFERENCE_DATA], no_of_uncolored_llc_conflict_misses[CACHE_REFERENCE_PAGE_TABLE]);
+
+    printf("\nPAGE COLORING STATS\n");
+    printf("Page Coloring: %s (%d colors)\n", PAGE_COLORING == PAGE_COLORING_PARTITIONED ? "partitioned" : PAGE_COLORING == PAGE_COLORING_ROUND_ROBIN ? "round robin" : "off", NO_OF_PAGE_COLORS);
+    printf("Frames Given From Another Color: %d\n", no_of_page_color_fallbacks);
+    printf("Frames Given Per Color:");
+    for (int i = 0; i < NO_OF_PAGE_COLORS; i++) {
+        printf(" %d", no_of_frames_given_per_color[i]);
+    }
+    printf("\n");
+
+    printf("\nCYCLE COST STATS\n");
+    long total_cycles = get_total_cycles();
+    if (no_of_memory_accesses > 0) {
+        printf("Average Memory Access Time: %.1f cycles (%d accesses)\n", (double)get_access_path_cycles() / no_of_memory_accesses, no_of_memory_accesses);
+    }
+    printf("Total Cycles: %ld\n", total_cycles);
+    for (int i = 0; i < NO_OF_COST_CAUSES && total_cycles > 0; i++) {
+        printf("%s: %ld cycles (%.1f%%)\n", cost_cause_names[i], cycles_by_cause[i], 100.0 * cycles_by_cause[i] / total_cycles);
+    }
+
+    printf("\nSCHEDULING STATS\n");
+    printf("Scheduler: %s on %d CPUs (%d-cycle quantum)\n", SCHEDULER == SCHEDULER_RANDOM ? "random" : "round robin", NO_OF_CPUS, TIME_QUANTUM);
+    printf("Simulated Time: %ld cycles (%d processes, %d accesses)\n", simulated_time, no_of_workload_processes, no_of_workload_accesses);
+    printf("Events: %ld\n", no_of_events);
+    printf("Event Queue Rate: %.0f events per second (%d events posted and taken with %d pending)\n", event_queue_rate, EVENT_QUEUE_BENCHMARK_EVENTS, EVENT_QUEUE_BENCHMARK_PENDING);
+    printf("Context Switches: %d (%d preemptions)\n", no_of_context_switches, no_of_preemptions);
+    if (simulated_time > 0) {
+        printf("CPU Utilization: %.1f%%\n", 100.0 * cpu_busy_time / ((double)NO_OF_CPUS * simulated_time));
+    }
+
+    printf("\nSHARED MEMORY STATS\n");
+    printf("Inner Page Table Sharing: %s\n", SHARE_INNER_PAGE_TABLES ? "on" : "off");
+    printf("Segments Created: %d\n", no_of_shared_memory_segments_created);
+    printf("Attachments: %d (%d through shared inner page tables)\n", no_of_shared_memory_attachments, no_of_shared_page_table_attachments);
+    printf("Page Table Entries Written By Attachments: %d (%d more without shared inner page tables)\n", no_of_shared_memory_page_table_writes, no_of_shared_memory_page_table_writes_saved);
+
+    printf("\nCUCKOO PAGE TABLE STATS\n");
+    if (no_of_page_walks > 0) {
+        printf("Cuckoo Page Table References Per Walk: %.2f\n", (double)no_of_cuckoo_walk_references / no_of_page_walks);
+        printf("Dependent Steps Per Walk: %.2f cuckoo (ways probed in parallel) vs %.2f two-level (pointer chasing)\n", (double)no_of_cuckoo_walk_steps / no_of_page_walks, (double)no_of_radix_walk_references / no_of_page_walks);
+    }
+    printf("Cuckoo Walk Cache Hits: %d\n", no_of_cuckoo_walk_cache_hits);
+    printf("Cuckoo Walk Cache Misses: %d\n", no_of_cuckoo_walk_cache_misses);
+    printf("Resizes: %d (%d stalled translation)\n", no_of_cuckoo_resizes, no_of_cuckoo_resize_stalls);
+    printf("Entries Displaced By Insertions: %d\n", no_of_cuckoo_kicks);
+    printf("Cuckoo Page Table Footprint: %d bytes\n", cuckoo_page_table_footprint);
+
+    printf("\nHUGE PAGE DAEMON STATS\n");
+    printf("Inner Page Tables Scanned: %d\n", no_of_inner_page_tables_scanned);
+    printf("Huge Page Collapses: %d\n", no_of_huge_page_collapses);
+    printf("Huge Page Splits: %d\n", no_of_huge_page_splits);
+    printf("Frames Copied: %d (%d bytes)\n", no_of_frames_copied, no_of_frames_copied * FRAME_SIZE);
+    printf("Bloat Frames (unpopulated pages filled by collapses): %d\n", no_of_bloat_frames);
+    printf("TLB Misses With Small, Uncoalesced Pages Only: %d\n", baseline_tlb.misses);
+    printf("TLB Misses Saved By Huge Pages And Coalescing: %d, at the cost of copying %d bytes\n", baseline_tlb.misses - tlb.misses, no_of_frames_copied * FRAME_SIZE);
+
+    printf("\nRANGE TRANSLATION STATS\n");
+    printf("Range Translation: %s\n", RANGE_TRANSLATION_MODE == RANGE_TRANSLATION_RANGE_TLB ? "range TLB" : RANGE_TRANSLATION_MODE == RANGE_TRANSLATION_DIRECT_SEGMENT ? "direct segments" : "off");
+    printf("Range TLB Hits (page walks avoided): %d\n", no_of_range_tlb_hits);
+    printf("Range TLB Misses: %d\n", no_of_range_tlb_misses);
+    printf("Range Table Walks: %d (%d references)\n", no_of_range_table_walks, no_of_range_table_walk_references);
+    printf("Direct Segment Accesses (TLB not used): %d\n", no_of_direct_segment_accesses);
+    printf("Page Walks On TLB Misses: %d with range translation vs %d TLB misses with small, uncoalesced pages only\n", no_of_demand_page_walks, baseline_tlb.misses);
+
+    printf("\nTLB PREFETCHING STATS\n");
+    printf("TLB Prefetcher: %s\n", TLB_PREFETCHER == TLB_PREFETCHER_SEQUENTIAL ? "sequential" : TLB_PREFETCHER == TLB_PREFETCHER_STRIDE ? "stride" : TLB_PREFETCHER == TLB_PREFETCHER_DISTANCE ? "distance" : "none");
+    printf("Workload Pattern: %s\n", WORKLOAD_PATTERN == WORKLOAD_PATTERN_SEQUENTIAL ? "sequential" : WORKLOAD_PATTERN == WORKLOAD_PATTERN_STRIDED ? "strided" : "random");
+    printf("Prefetches: %d (%d used)\n", no_of_prefetches, no_of_useful_prefetches);
+    if (no_of_prefetches > 0) {
+        printf("Prefetch Accuracy: %.1f%%\n", 100.0 * no_of_useful_prefetches / no_of_prefetches);
+    }
+    if (tlb.misses > 0) {
+        printf("Prefetch Coverage (TLB misses served by the prefetch buffer): %.1f%%\n", 100.0 * no_of_useful_prefetches / tlb.misses);
+    }
+    printf("Extra Page Walks Made By The Prefetcher: %d\n", no_of_prefetch_walks);
+
+    printf("\nTLB COALESCING STATS\n");
+    printf("Coalesced TLB Fills: %d (%d extra pages covered)\n", no_of_coalesced_tlb_fills, no_of_pages_coalesced);
+    if (no_of_memory_accesses > 0) {
+        printf("Average TLB Reach: %.1f bytes (%.1f bytes with small, uncoalesced pages only)\n", (double)tlb_reach_samples * PAGE_SIZE / no_of_memory_accesses,
+        (double)baseline_tlb_reach_samples * PAGE_SIZE / no_of_memory_accesses);
+    }
+}
+
+// --- FRAMES, TLB AND PAGE WALKS ---
+
+
+/**
+ * @brief Get the page table entry of a page of a process. The inner page table number and offset are obtained from the page number. If the outer page table entry points to a shared inner page table, the entry is in there.
+ * 
+ * @param process The process whose page table entry is to be found.
+ * @param page_number The page whose entry is to be found.
+ * @return A pointer to the page table entry.
+ */
+struct page_table_entry *get_page_table_entry(struct PCB *process, int page_number) {
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    int inner_page_table_offset = page_number % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+
+    if (shared_inner_page_tables[process->id][inner_page_table_no] != NULL) {
+        return &shared_inner_page_tables[process->id][inner_page_table_no][inner_page_table_offset];
+    }
+    return &process->inner_page_tables[inner_page_table_no][inner_page_table_offset];
+}
+
+
+/**
+ * @brief Find the number of pages a process occupies in virtual memory. Pages past the end of virtual memory are not counted.
+ * 
+ * @param process The process whose pages are to be counted.
+ * @return The number of pages the process occupies. It's 0 if the process hasn't been assigned a page.
+ */
+int get_process_page_count(struct PCB *process) {
+    if (process->start_page_number == -1) {
+        return 0;
+    }
+
+    int no_of_pages = (int)ceil((double)process->size_in_memory / PAGE_SIZE);
+    if (process->start_page_number + no_of_pages > NO_OF_PAGES) {
+        no_of_pages = NO_OF_PAGES - process->start_page_number;
+    }
+    return no_of_pages;
+}
+
+
+/**
+ * @brief Check whether a frame is free. A frame is free if none of its bytes belongs to a process.
+ * 
+ * @param frame_number The frame to be checked.
+ * @return true if the frame is free and false if otherwise.
+ */
+bool is_frame_free(int frame_number) {
+    for (int j = 0; j < FRAME_SIZE; j++) {
+        if (physical_memory[frame_number][j].id != -1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief Find the first block of consecutive free frames whose starting frame number is a multiple of the alignment.
+ * 
+ * @param no_of_frames The number of frames in the block.
+ * @param alignment The alignment of the block in frames. An alignment of 1 accepts any block.
+ * @return The starting frame number of the block. It returns -1 if there is no such block.
+ */
+int find_free_frame_block(int no_of_frames, int alignment) {
+    for (int i = 0; i + no_of_frames <= NO_OF_FRAMES; i += alignment) {
+        int frame_counter = 0;
+        while (frame_counter < no_of_frames && is_frame_free(i + frame_counter)) {
+            frame_counter++;
+        }
+
+        if (frame_counter == no_of_frames) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Mark every byte of a frame as belonging to a process. The frame starts with a single reference, and is filled with zeros.
+ * 
+ * @param frame_number The frame to be claimed.
+ * @param process The process the frame now belongs to.
+ */
+void claim_frame(int frame_number, struct PCB *process) {
+    for (int j = 0; j < FRAME_SIZE; j++) {
+        physical_memory[frame_number][j] = *process;
+    }
+    memset(frame_contents[frame_number], 0, FRAME_SIZE);
+    frame_reference_counts[frame_number] = 1;
+    is_ksm_frame[frame_number] = 0;
+}
+
+
+/**
+ * @brief Drop a reference to a frame. When no reference is left, the frame is freed by marking every byte of it as empty.
+ * 
+ * @param frame_number The frame to be released.
+ */
+void release_frame(int frame_number) {
+    if (frame_reference_counts[frame_number] > 1) {
+        frame_reference_counts[frame_number]--;
+        return;
+    }
+
+    frame_reference_counts[frame_number] = 0;
+    is_ksm_frame[frame_number] = 0;
+    for (int j = 0; j < FRAME_SIZE; j++) {
+        physical_memory[frame_number][j].id = -1;
+    }
+}
+
+
+/**
+ * @brief Add a reference to a frame, for a page table entry of another process that maps on to it.
+ * 
+ * @param frame_number The frame being shared.
+ */
+void share_frame(int frame_number) {
+    frame_reference_counts[frame_number]++;
+}
+
+
+/**
+ * @brief Record in the reverse map that a page of a process maps on to a frame.
+ * 
+ * @param frame_number The frame.
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page mapping on to the frame.
+ */
+void reverse_map_insert(int frame_number, int process_id, int page_number) {
+    int mapping = process_id * NO_OF_PAGES + page_number;
+    reverse_map_next[mapping] = reverse_map_heads[frame_number];
+    reverse_map_heads[frame_number] = mapping;
+}
+
+
+/**
+ * @brief Remove the mapping of a page of a process from the reverse map of a frame.
+ * 
+ * @param frame_number The frame.
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page that no longer maps on to the frame.
+ */
+void reverse_map_remove(int frame_number, int process_id, int page_number) {
+    int mapping = process_id * NO_OF_PAGES + page_number;
+    int *link = &reverse_map_heads[frame_number];
+
+    while (*link != -1 && *link != mapping) {
+        link = &reverse_map_next[*link];
+    }
+    if (*link == mapping) {
+        *link = reverse_map_next[mapping];
+    }
+}
+
+
+/**
+ * @brief Count the page table entries mapping a frame, according to the reverse map. Shared inner page tables aren't in the reverse map, so it can be less than the frame's reference count.
+ * 
+ * @param frame_number The frame.
+ * @return The number of mappings of the frame.
+ */
+int get_reverse_map_count(int frame_number) {
+    int no_of_mappings = 0;
+    for (int mapping = reverse_map_heads[frame_number]; mapping != -1; mapping = reverse_map_next[mapping]) {
+        no_of_mappings++;
+    }
+    return no_of_mappings;
+}
+
+
+/**
+ * @brief Copy the contents of a frame into another frame.
+ * 
+ * @param destination_frame_number The frame to copy into.
+ * @param source_frame_number The frame to copy from.
+ */
+void copy_frame(int destination_frame_number, int source_frame_number) {
+    for (int j = 0; j < FRAME_SIZE; j++) {
+        physical_memory[destination_frame_number][j] = physical_memory[source_frame_number][j];
+    }
+    memcpy(frame_contents[destination_frame_number], frame_contents[source_frame_number], FRAME_SIZE);
+}
+
+
+/**
+ * @brief Initialize a TLB by marking every entry as invalid.
+ * 
+ * @param tlb The TLB to be initialized.
+ */
+void initialize_tlb(struct tlb *tlb) {
+    for (int i = 0; i < TLB_SIZE; i++) {
+        tlb->entries[i].valid = 0;
+    }
+    tlb->hits = 0;
+    tlb->misses = 0;
+}
+
+
+/**
+ * @brief Look up the translation of a page in a TLB. Every entry is compared at once, since the TLB is fully associative.
+ * 
+ * @param tlb The TLB to search.
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page to be translated.
+ * @return A pointer to the entry covering the page, or NULL if the TLB doesn't hold the translation.
+ */
+struct tlb_entry *tlb_lookup(struct tlb *tlb, int process_id, int page_number) {
+    tlb_clock++;
+
+    for (int i = 0; i < TLB_SIZE; i++) {
+        struct tlb_entry *entry = &tlb->entries[i];
+        if (entry->valid == 1 && entry->process_id == process_id && page_number >= entry->page_number && page_number < entry->page_number + entry->no_of_pages) {
+            entry->last_used = tlb_clock;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Insert a translation into a TLB. If the TLB is full, the least recently used entry is replaced.
+ * 
+ * @param tlb The TLB to insert into.
+ * @param entry The translation to be inserted.
+ */
+void tlb_insert(struct tlb *tlb, struct tlb_entry entry) {
+    int victim = 0;
+
+    for (int i = 0; i < TLB_SIZE; i++) {
+        if (tlb->entries[i].valid == 0) {
+            victim = i;
+            break;
+        }
+        if (tlb->entries[i].last_used < tlb->entries[victim].last_used) {
+            victim = i;
+        }
+    }
+
+    entry.valid = 1;
+    entry.last_used = tlb_clock;
+    tlb->entries[victim] = entry;
+}
+
+
+/**
+ * @brief Invalidate every entry of a TLB that covers any page in a range of pages of a process. This is the TLB shootdown done whenever a mapping changes.
+ * 
+ * @param tlb The TLB whose entries are to be invalidated.
+ * @param process_id The id of the process whose translations are to be invalidated.
+ * @param page_number The first page of the range.
+ * @param no_of_pages The number of pages in the range.
+ */
+void tlb_invalidate(struct tlb *tlb, int process_id, int page_number, int no_of_pages) {
+    for (int i = 0; i < TLB_SIZE; i++) {
+        struct tlb_entry *entry = &tlb->entries[i];
+        if (entry->valid == 1 && entry->process_id == process_id && entry->page_number < page_number + no_of_pages && page_number < entry->page_number + entry->no_of_pages) {
+            entry->valid = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Find the number of pages covered by the valid entries of a TLB.
+ * 
+ * @param tlb The TLB.
+ * @return The number of pages the TLB can translate without a page walk.
+ */
+int get_tlb_reach(struct tlb *tlb) {
+    int no_of_pages = 0;
+
+    for (int i = 0; i < TLB_SIZE; i++) {
+        if (tlb->entries[i].valid == 1) {
+            no_of_pages += tlb->entries[i].no_of_pages;
+        }
+    }
+    return no_of_pages;
+}
+
+
+/**
+ * @brief Invalidate the translations of a range of pages of a process wherever the MMU caches them: the TLB and the prefetch buffer. This is the TLB shootdown done whenever a mapping changes. The baseline TLB is invalidated with them, so it never keeps a stale translation either.
+ * 
+ * @param process_id The id of the process whose translations are to be invalidated.
+ * @param page_number The first page of the range.
+ * @param no_of_pages The number of pages in the range.
+ */
+void tlb_shootdown(int process_id, int page_number, int no_of_pages) {
+    tlb_invalidate(&tlb, process_id, page_number, no_of_pages);
+    tlb_invalidate(&baseline_tlb, process_id, page_number, no_of_pages);
+    charge_cycles(COST_TLB_SHOOTDOWN, TLB_SHOOTDOWN_COST);
+
+    for (int i = 0; i < PREFETCH_BUFFER_SIZE; i++) {
+        struct tlb_entry *entry = &prefetch_buffer[i];
+        if (entry->valid == 1 && entry->process_id == process_id && entry->page_number < page_number + no_of_pages && page_number < entry->page_number + entry->no_of_pages) {
+            entry->valid = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Check whether any of a set of TLB entries covers a page. Unlike tlb_lookup, this doesn't count as a use of the entry.
+ * 
+ * @param entries The TLB entries to be searched.
+ * @param no_of_entries The number of entries.
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page.
+ * @return true if an entry covers the page and false if otherwise.
+ */
+bool is_page_in_tlb_entries(struct tlb_entry *entries, int no_of_entries, int process_id, int page_number) {
+    for (int i = 0; i < no_of_entries; i++) {
+        if (entries[i].valid == 1 && entries[i].process_id == process_id && page_number >= entries[i].page_number && page_number < entries[i].page_number + entries[i].no_of_pages) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Coalesce a single page translation with the neighbouring pages that map on to the neighbouring frames, so that one TLB entry covers them all. allocate_memory places a process in consecutive frames, so this is common. Neighbours are only looked for in the aligned group of TLB_COALESCING_MAX_PAGES pages the page is in, and the page table entries are read from the two-level page tables. Each inner page table besides the page's own costs one more page walk reference, which goes through the caches. Entries already in the TLB for pages of the run are invalidated, since the new entry covers them.
+ * 
+ * @param process The process the translation belongs to.
+ * @param page_number The page that missed in the TLB.
+ * @param translation The translation of the page. It's widened to cover the run of pages.
+ */
+void coalesce_translation(struct PCB *process, int page_number, struct tlb_entry *translation) {
+    if (TLB_COALESCING_MAX_PAGES <= 1 || translation->no_of_pages != 1) {
+        return;
+    }
+
+    int group_start = page_number - page_number % TLB_COALESCING_MAX_PAGES;
+    int group_end = group_start + TLB_COALESCING_MAX_PAGES;
+    int first_page = page_number;
+    int last_page = page_number;
+
+    while (first_page - 1 >= group_start) {
+        struct page_table_entry *pte = get_page_table_entry(process, first_page - 1);
+        if (pte->valid == 0 || process->huge_pages[(first_page - 1) / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE] == 1 || pte->frame_number != translation->frame_number - (page_number - first_page + 1)) {
+            break;
+        }
+        first_page--;
+    }
+
+    while (last_page + 1 < group_end) {
+        struct page_table_entry *pte = get_page_table_entry(process, last_page + 1);
+        if (pte->valid == 0 || process->huge_pages[(last_page + 1) / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE] == 1 || pte->frame_number != translation->frame_number + (last_page + 1 - page_number)) {
+            break;
+        }
+        last_page++;
+    }
+
+    // one more reference for every other inner page table read: the entry next to the page's own inner page table
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    for (int i = first_page / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; i <= last_page / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; i++) {
+        if (i < inner_page_table_no) {
+            reference_page_table_entry(process, (i + 1) * NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE - 1, false);
+        }
+        else if (i > inner_page_table_no) {
+            reference_page_table_entry(process, i * NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE, false);
+        }
+    }
+
+    if (first_page == last_page) {
+        return;
+    }
+
+    translation->frame_number -= page_number - first_page;
+    translation->page_number = first_page;
+    translation->no_of_pages = last_page - first_page + 1;
+    tlb_invalidate(&tlb, process->id, first_page, translation->no_of_pages);
+
+    no_of_coalesced_tlb_fills++;
+    no_of_pages_coalesced += translation->no_of_pages - 1;
+}
+
+
+/**
+ * @brief Set the page table entry of a page of a process. A newly mapped page is writable. Every change to a page table entry goes through this function, so that the inverted page table and the small page cuckoo page table always hold the same mappings as the process' page tables, the reverse map knows every mapping of a frame, range TLB entries covering a changed page are invalidated, the range table is marked as stale, and a guest's frames are given guest-physical frames in its host page table (and its shadow page table is synchronized).
+ * 
+ * @param process The process whose page table entry is to be set.
+ * @param page_number The page whose entry is to be set.
+ * @param frame_number The frame the page now maps on to. If it's -1, the page is unmapped.
+ * @return true if the page is mapped as asked and false if it's left unmapped instead, because a guest had no free guest-physical frame for it. The caller keeps the reference it took on the frame.
+ */
+bool set_page_table_entry(struct PCB *process, int page_number, int frame_number) {
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+
+    if (pte->valid == 1) {
+        // A shared frame's inverted page table entry may belong to another process
+        if (inverted_page_table[pte->frame_number].process_id == process->id && inverted_page_table[pte->frame_number].page_number == page_number) {
+            inverted_page_table_remove(pte->frame_number);
+        }
+        cuckoo_page_table_remove(&cuckoo_page_tables[process->id][SMALL_PAGE_SIZE_INDEX], page_number);
+        range_tlb_invalidate(process->id, page_number);
+        reverse_map_remove(pte->frame_number, process->id, page_number);
+        if (process->is_guest) {
+            free_guest_frame(process, pte->guest_frame_number);
+        }
+
+        if (is_faulted_around[process->id][page_number] == 1) {
+            is_faulted_around[process->id][page_number] = 0;
+            no_of_fault_around_pages_wasted++;
+        }
+        if (is_read_ahead[process->id][page_number] == 1) {
+            is_read_ahead[process->id][page_number] = 0;
+            no_of_readahead_pages_wasted++;
+        }
+    }
+    range_tables[process->id].is_stale = 1;
+
+    pte->frame_number = frame_number;
+    pte->valid = frame_number != -1;
+    pte->writable = frame_number != -1;
+    pte->accessed = 0;
+    pte->dirty = 0;
+    pte->guest_frame_number = -1;
+    bool is_mapped = true;
+    if (process->is_guest && frame_number != -1) {
+        pte->guest_frame_number = allocate_guest_frame(process, frame_number);
+        if (pte->guest_frame_number == -1) {
+            printf("Process %d has no free guest-physical frame for page %d. The page is left unmapped.\n", process->id, page_number);
+            is_mapped = false;
+            frame_number = -1;
+            pte->frame_number = -1;
+            pte->valid = 0;
+            pte->writable = 0;
+        }
+    }
+    if (process->is_guest) {
+        trap_guest_page_table_write(process, page_number);
+    }
+
+    if (frame_number != -1) {
+        // Every page mapped on to the zero frame would take its entry from the last one. It's loaded by the walks that need it instead.
+        if (frame_number != zero_frame_number) {
+            inverted_page_table_insert(frame_number, process->id, page_number);
+        }
+        cuckoo_page_table_insert(&cuckoo_page_tables[process->id][SMALL_PAGE_SIZE_INDEX], page_number, frame_number);
+        reverse_map_insert(frame_number, process->id, page_number);
+    }
+    cuckoo_walk_cache_invalidate(process->id, page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE);
+    return is_mapped;
+}
+
+
+/**
+ * @brief Translate a page by walking the page table structure chosen at startup. The page is looked up in the other structures too, only to count what the lookup would have cost. The two-level walk of a guest process is either a nested walk through its guest and host page tables or a native walk of its shadow page table, depending on VIRTUALIZATION_MODE (the other is walked too, for comparison). The hashed structures translate a guest's pages natively.
+ * 
+ * @param process The process whose page is to be translated.
+ * @param page_number The page to be translated.
+ * @param translation Filled with the translation if the page is mapped. For a huge page, it covers the whole huge page.
+ * @return true if the page is mapped and false if otherwise.
+ */
+bool walk_page_table(struct PCB *process, int page_number, struct tlb_entry *translation) {
+    struct tlb_entry radix_translation;
+    struct tlb_entry inverted_translation;
+    struct tlb_entry cuckoo_translation;
+    int no_of_radix_references = 0;
+    int no_of_inverted_references = 0;
+    int no_of_cuckoo_references = 0;
+
+    bool is_mapped_in_radix;
+    if (process->is_guest) {
+        struct tlb_entry nested_translation;
+        struct tlb_entry shadow_translation;
+        int no_of_nested_references = 0;
+        int no_of_shadow_references = 0;
+        bool is_mapped_in_nested = walk_nested_page_table(process, page_number, &nested_translation, &no_of_nested_references);
+        bool is_mapped_in_shadow = walk_shadow_page_table(process, page_number, &shadow_translation, &no_of_shadow_references);
+
+        if (VIRTUALIZATION_MODE == VIRTUALIZATION_MODE_SHADOW) {
+            is_mapped_in_radix = is_mapped_in_shadow;
+            radix_translation = shadow_translation;
+            no_of_radix_references += no_of_shadow_references;
+        }
+        else {
+            is_mapped_in_radix = is_mapped_in_nested;
+            radix_translation = nested_translation;
+            no_of_radix_references += no_of_nested_references;
+        }
+    }
+    else {
+        is_mapped_in_radix = walk_radix_page_table(process, page_number, &radix_translation, &no_of_radix_references);
+    }
+    bool is_mapped_in_inverted = walk_inverted_page_table(process, page_number, &inverted_translation, &no_of_inverted_references);
+    bool is_mapped_in_cuckoo = walk_cuckoo_page_table(process, page_number, &cuckoo_translation, &no_of_cuckoo_references);
+
+    no_of_page_walks++;
+    no_of_radix_walk_references += no_of_radix_references;
+    no_of_inverted_walk_references += no_of_inverted_references;
+    no_of_cuckoo_walk_references += no_of_cuckoo_references;
+
+    if (page_table_mode == PAGE_TABLE_MODE_INVERTED) {
+        add_page_walk_references(no_of_inverted_references);
+        *translation = inverted_translation;
+        return is_mapped_in_inverted;
+    }
+
+    if (page_table_mode == PAGE_TABLE_MODE_CUCKOO) {
+        add_page_walk_references(no_of_cuckoo_references);
+        *translation = cuckoo_translation;
+        return is_mapped_in_cuckoo;
+    }
+
+    // A native radix walk's references go through the caches. Nested and shadow walks are charged as memory references.
+    if (process->is_guest) {
+        add_page_walk_references(no_of_radix_references);
+    }
+    else {
+        reference_page_table_entry(process, page_number, true);
+        if (process->huge_pages[page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE] == 0) {
+            reference_page_table_entry(process, page_number, false);
+        }
+    }
+    *translation = radix_translation;
+    return is_mapped_in_radix;
+}
+
+
+/**
+ * @brief Walk the two-level page table of a process to translate a page. The outer page table entry is read first. If it maps a huge page, the walk ends there. Otherwise, the entry of the page in the inner page table is read.
+ * 
+ * @param process The process whose page table is walked.
+ * @param page_number The page to be translated.
+ * @param translation Filled with the translation if the page is mapped. For a huge page, it covers the whole huge page.
+ * @param no_of_references Increased by the number of page table entries read.
+ * @return true if the page is mapped and false if otherwise.
+ */
+bool walk_radix_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references) {
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+
+    (*no_of_references)++; // outer page table entry
+
+    translation->process_id = process->id;
+
+    if (process->huge_pages[inner_page_table_no] == 1) {
+        translation->page_number = inner_page_table_no * PAGES_PER_HUGE_PAGE;
+        translation->frame_number = process->inner_page_tables[inner_page_table_no][0].frame_number;
+        translation->no_of_pages = PAGES_PER_HUGE_PAGE;
+        return true;
+    }
+
+    (*no_of_references)++; // inner page table entry
+
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+    if (pte->valid == 0) {
+        return false;
+    }
+
+    translation->page_number = page_number;
+    translation->frame_number = pte->frame_number;
+    translation->no_of_pages = 1;
+    return true;
+}
+
+
+/**
+ * @brief Access a logical address of a process the way the MMU would. The TLB is searched first (unless the address is in the process' direct segment, which needs no TLB). On a TLB miss, the prefetch buffer and the range TLB are searched, and if they miss too, the page table is walked. The translation, coalesced with its neighbours where possible, is inserted into the TLB, and the TLB prefetcher learns from the miss. If the page isn't mapped, the page fault is handled and the walk is retried. A write to a page that isn't writable causes a copy-on-write fault. The page's accessed bit is set, and its dirty bit too on a write. The TLB caches the permission bits of the page table entry, so they are read from the entry here (every change that takes a permission away shoots the TLB down).
+ * 
+ * @param process The process accessing memory.
+ * @param logical_address The logical address being accessed.
+ * @param is_write Indicates whether the access is a write.
+ * @return The physical address the logical address translates to. It returns -1 if the page fault couldn't be handled.
+ */
+int access_memory(struct PCB *process, int logical_address, bool is_write) {
+    no_of_memory_accesses++;
+    charge_cycles(COST_TLB, TLB_LOOKUP_COST);
+
+    int page_number = logical_address / PAGE_SIZE;
+    int offset = logical_address % PAGE_SIZE;
+    int frame_number;
+    bool is_fault = false;
+
+    // A page faulted around or read ahead only saved a fault if this first access to it completes without one
+    bool is_faulted_around_page = is_faulted_around[process->id][page_number] == 1;
+    bool is_read_ahead_page = is_read_ahead[process->id][page_number] == 1;
+    is_faulted_around[process->id][page_number] = 0;
+    is_read_ahead[process->id][page_number] = 0;
+
+    struct tlb_entry *entry = NULL;
+    struct range_table_entry *direct_segment = NULL;
+    if (RANGE_TRANSLATION_MODE == RANGE_TRANSLATION_DIRECT_SEGMENT) {
+        direct_segment = get_direct_segment(process);
+    }
+
+    if (direct_segment != NULL && page_number >= direct_segment->base && page_number < direct_segment->limit) {
+        no_of_direct_segment_accesses++;
+        frame_number = page_number + direct_segment->offset;
+    }
+    else if ((entry = tlb_lookup(&tlb, process->id, page_number)) != NULL) {
+        tlb.hits++;
+        frame_number = entry->frame_number + (page_number - entry->page_number);
+    }
+    else {
+        tlb.misses++;
+
+        struct tlb_entry translation;
+        struct range_tlb_entry *range_entry = NULL;
+        bool is_prefetched = prefetch_buffer_take(process->id, page_number, &translation);
+        if (!is_prefetched && RANGE_TRANSLATION_MODE == RANGE_TRANSLATION_RANGE_TLB) {
+            range_entry = range_tlb_lookup(process->id, page_number);
+        }
+
+        if (is_prefetched) {
+            // The prefetcher already walked the page table for this page
+        }
+        else if (range_entry != NULL) {
+            // The range TLB translates the page without a page walk
+            struct tlb_entry range_translation = {1, process->id, page_number, page_number + range_entry->range.offset, 1, 0};
+            translation = range_translation;
+        }
+        else {
+            no_of_demand_page_walks++;
+            if (!walk_page_table(process, page_number, &translation)) {
+                is_fault = true;
+                if (handle_page_fault(process, page_number) == -1) {
+                    return -1;
+                }
+                walk_page_table(process, page_number, &translation);
+            }
+
+            // The range table is walked alongside, so that later misses in the same range don't need a page walk
+            struct range_table_entry range;
+            if (RANGE_TRANSLATION_MODE == RANGE_TRANSLATION_RANGE_TLB && walk_range_table(process, page_number, &range)) {
+                range_tlb_insert(process->id, range);
+            }
+        }
+
+        coalesce_translation(process, page_number, &translation);
+        tlb_insert(&tlb, translation);
+        frame_number = translation.frame_number + (page_number - translation.page_number);
+
+        train_tlb_prefetcher(process, page_number);
+    }
+
+    if (is_write && get_page_table_entry(process, page_number)->writable == 0) {
+        is_fault = true;
+        frame_number = handle_copy_on_write_fault(process, page_number);
+        if (frame_number == -1) {
+            return -1;
+        }
+    }
+
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+    pte->accessed = 1;
+    if (is_write) {
+        pte->dirty = 1;
+    }
+
+    // The baseline TLB sees the same access, but only ever caches the page itself.
+    if (tlb_lookup(&baseline_tlb, process->id, page_number) != NULL) {
+        baseline_tlb.hits++;
+    }
+    else {
+        baseline_tlb.misses++;
+        struct tlb_entry small_page_translation = {1, process->id, page_number, frame_number, 1, 0};
+        tlb_insert(&baseline_tlb, small_page_translation);
+    }
+
+    tlb_reach_samples += get_tlb_reach(&tlb);
+    baseline_tlb_reach_samples += get_tlb_reach(&baseline_tlb);
+
+    if (is_faulted_around_page && !is_fault) {
+        no_of_fault_around_hits++;
+    }
+    if (is_read_ahead_page && !is_fault) {
+        no_of_readahead_hits++;
+    }
+
+    int physical_address = frame_number * FRAME_SIZE + offset;
+    charge_cycles(COST_DATA, access_cache_hierarchy(physical_address, CACHE_REFERENCE_DATA, DATA_REFERENCE_COST));
+    return physical_address;
+}
+
+
+/**
+ * @brief Handle a page fault by assigning a free frame to the page. Unlike allocate_memory, only the faulting page is given a frame, and it can be any free frame (a page is evicted if none is free). A page that was swapped out is swapped back in, along with the pages after it if the faults look sequential (readahead) and its neighbours whose data is still in memory (fault-around). Otherwise, if zero-fill-on-demand is on, the page is mapped read-only on to the zero frame instead, and gets a frame of its own when it's first written.
+ * 
+ * @param process The process that caused the page fault.
+ * @param page_number The page that isn't mapped.
+ * @return The frame number assigned to the page. It returns -1 if no frame is free.
+ */
+int handle_page_fault(struct PCB *process, int page_number) {
+    no_of_page_faults++;
+    printf("Page Fault (Page %d of process %d has not yet been assigned a frame).\n", page_number, process->id);
+
+    if (get_page_table_entry(process, page_number)->swap_slot != -1) {
+        charge_cycles(COST_MAJOR_FAULT, MAJOR_FAULT_COST);
+        int frame_number = swap_in_page(process, page_number);
+        if (frame_number != -1) {
+            readahead_pinned_frame = frame_number;
+            read_ahead(process, page_number);
+            readahead_pinned_frame = -1;
+            if (FAULT_AROUND) {
+                fault_around(process, page_number);
+            }
+        }
+        return frame_number;
+    }
+
+    charge_cycles(COST_MINOR_FAULT, MINOR_FAULT_COST);
+    if (ZERO_FILL_ON_DEMAND) {
+        share_frame(zero_frame_number);
+        if (!set_page_table_entry(process, page_number, zero_frame_number)) {
+            release_frame(zero_frame_number);
+            return -1;
+        }
+        write_protect_page(process, page_number);
+        return zero_frame_number;
+    }
+
+    int frame_number = allocate_frame(process);
+    if (frame_number == -1) {
+        printf("No free frame was found for page %d of process %d\n", page_number, process->id);
+        return -1;
+    }
+
+    if (!set_page_table_entry(process, page_number, frame_number)) {
+        release_frame(frame_number);
+        return -1;
+    }
+
+    return frame_number;
+}
+
+
+/**
+ * @brief Unmap a single page of a process and free its frame (or its swap slot, if it was swapped out). If the page is part of a huge page, the huge page is split into small pages first, so that the rest of it stays mapped.
+ * 
+ * @param process The process whose page is to be unmapped.
+ * @param page_number The page to be unmapped.
+ */
+void unmap_page(struct PCB *process, int page_number) {
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+
+    if (pte->swap_slot != -1) {
+        free_swap_slot(pte->swap_slot);
+        pte->swap_slot = -1;
+        return;
+    }
+
+    // Shared memory is only unmapped by detaching the whole segment
+    if (pte->valid == 0 || get_shared_memory_segment(process, page_number) != -1) {
+        return;
+    }
+
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    if (process->huge_pages[inner_page_table_no] == 1) {
+        split_huge_page(process, inner_page_table_no);
+    }
+
+    release_frame(pte->frame_number);
+    set_page_table_entry(process, page_number, -1);
+
+    tlb_shootdown(process->id, page_number, 1);
+}
+
+
+/**
+ * @brief Run a workload of memory accesses as a discrete-event simulation. Every process arrives at time 0 and is scheduled on to the CPUs by SCHEDULER. A running process makes an access every WORKLOAD_COMPUTE_TIME cycles until its quantum is over, it's suspended on a major fault or it has made ACCESSES_PER_PROCESS accesses, and the huge page daemon and the same-page merging scanner wake up periodically. Forked children arrive when they're forked. The workload is over when every process has left it.
+ * 
+ * @param num_of_processes The number of processes created.
+ */
+void run_workload(int num_of_processes) {
+    printf("Running a workload of %d processes making %d memory accesses each...\n", num_of_processes, ACCESSES_PER_PROCESS);
+
+    initialize_event_queue();
+    for (int i = 0; i < num_of_processes; i++) {
+        workload_accesses_left[i] = ACCESSES_PER_PROCESS;
+        no_of_live_processes++;
+        post_event(0, EVENT_PROCESS_ARRIVAL, i);
+    }
+    no_of_workload_processes = num_of_processes;
+    post_event(HUGE_PAGE_DAEMON_PERIOD, EVENT_HUGE_PAGE_DAEMON_WAKEUP, -1);
+    post_event(KSM_PERIOD, EVENT_KSM_WAKEUP, -1);
+
+    struct event event;
+    while (no_of_live_processes > 0 && take_event(&event)) {
+        simulated_time = event.time;
+        handle_event(&event);
+    }
+
+    flush_invalidation_queue();
+    if (swap_file != NULL) {
+        flush_swap_writes();
+    }
+    measure_event_queue_rate();
+
+    printf("Workload complete: %d memory accesses in %ld cycles.\n\n", no_of_workload_accesses, simulated_time);
+}
+
+
+/**
+ * @brief Make the next access of a process in the workload. It's to an address within the pages the process occupies, chosen according to WORKLOAD_PATTERN, and is a write WORKLOAD_WRITE_PERCENT of the time. Some accesses of a process with shared memory attached go to a shared memory segment instead. A write stores a byte that only depends on its offset within the page, as if every process ran the same program, so identical pages are common. Every now and then, counted across all processes, the process also unmaps one of its pages, does an I/O, does a scatter-gather I/O of all its memory, copies a message out of another process and is passed one, forks or attaches a shared memory segment.
+ * 
+ * @param process The process making the access.
+ */
+void run_workload_step(struct PCB *process) {
+    int i = ++no_of_workload_accesses;
+    int no_of_pages = get_process_page_count(process);
+
+    if (no_of_pages > 0) {
+        int logical_address = generate_workload_logical_address(process, no_of_pages);
+        int shared_memory_logical_address = generate_shared_memory_logical_address(process);
+        if (shared_memory_logical_address != -1 && rand() % 100 < WORKLOAD_SHARED_MEMORY_PERCENT) {
+            logical_address = shared_memory_logical_address;
+        }
+        unsigned char value = (unsigned char)(logical_address % PAGE_SIZE + 1);
+        if (rand() % 100 < WORKLOAD_WRITE_PERCENT) {
+            store_memory(process, logical_address, &value, 1);
+        }
+        else {
+            load_memory(process, logical_address, &value, 1);
+        }
+
+        if (i % WORKLOAD_UNMAP_INTERVAL == 0) {
+            unmap_page(process, process->start_page_number + rand() % no_of_pages);
+        }
+
+        if (i % DMA_IO_INTERVAL == 0) {
+            run_dma_io(process);
+        }
+
+        if (i % WORKLOAD_SHARED_MEMORY_INTERVAL == 0) {
+            char name[SHARED_MEMORY_NAME_LENGTH];
+            snprintf(name, sizeof(name), "/segment-%d", rand() % NO_OF_SHARED_MEMORY_SEGMENTS);
+            int segment_id = open_shared_memory_segment(name, process);
+            if (segment_id != -1 && shared_memory_attachments[process->id][segment_id] == -1) {
+                attach_shared_memory_segment(process, segment_id, -1);
+            }
+        }
+
+        if (i % SCATTER_GATHER_INTERVAL == 0) {
+            run_scatter_gather_io(process);
+        }
+
+        if (i % WORKLOAD_MESSAGE_INTERVAL == 0) {
+            copy_message(process, no_of_workload_processes);
+            pass_message(process, no_of_workload_processes);
+        }
+
+        if (i % WORKLOAD_FORK_INTERVAL == 0 && no_of_workload_processes < MAX_PROCESS_COUNT) {
+            int child_id = no_of_workload_processes++;
+            fork_process(process, child_id);
+            workload_accesses_left[child_id] = ACCESSES_PER_PROCESS;
+            no_of_live_processes++;
+            post_event(simulated_time, EVENT_PROCESS_ARRIVAL, child_id);
+        }
+    }
+}
+
+
+/**
+ * @brief Generate the next logical address a process accesses in the workload, according to WORKLOAD_PATTERN.
+ * 
+ * @param process The process making the access.
+ * @param no_of_pages The number of pages the process occupies.
+ * @return The logical address to be accessed. It's always within the pages the process occupies.
+ */
+int generate_workload_logical_address(struct PCB *process, int no_of_pages) {
+    int region_size = no_of_pages * PAGE_SIZE;
+    int *position = &workload_positions[process->id];
+
+    if (WORKLOAD_PATTERN == WORKLOAD_PATTERN_SEQUENTIAL) {
+        *position = (*position + WORKLOAD_SEQUENTIAL_STEP) % region_size;
+    }
+    else if (WORKLOAD_PATTERN == WORKLOAD_PATTERN_STRIDED) {
+        *position = (*position + WORKLOAD_STRIDE_PAGES * PAGE_SIZE) % region_size;
+    }
+    else {
+        *position = rand() % region_size;
+    }
+
+    return process->start_page_number * PAGE_SIZE + *position;
+}
+
+
+// --- HUGE PAGES ---
+
+
+/**
+ * @brief Collapse an inner page table of a process into a huge page. If the mapped pages already sit in an aligned block of consecutive frames, the outer page table entry is simply promoted. Otherwise, an aligned block of free frames is found, the mapped pages are copied into it, and their old frames are freed. Unpopulated entries (at most HUGE_PAGE_DAEMON_MAX_PTES_NONE of them) are filled with new frames, which is the memory bloat of the huge page.
+ * 
+ * @param process The process whose inner page table is to be collapsed.
+ * @param inner_page_table_no The inner page table to be collapsed.
+ * @return true if the inner page table was collapsed and false if otherwise.
+ */
+bool collapse_huge_page(struct PCB *process, int inner_page_table_no) {
+    struct page_table_entry *inner_page_table = process->inner_page_tables[inner_page_table_no];
+
+    if (process->huge_pages[inner_page_table_no] == 1) {
+        return false;
+    }
+    for (int j = 0; j < PAGES_PER_HUGE_PAGE; j++) {
+        if (get_shared_memory_segment(process, inner_page_table_no * PAGES_PER_HUGE_PAGE + j) != -1) {
+            return false;
+        }
+    }
+
+    int no_of_mapped_pages = 0;
+    bool is_in_place = inner_page_table[0].valid == 1 && inner_page_table[0].frame_number % PAGES_PER_HUGE_PAGE == 0;
+
+    // Pages mapped on to the zero frame count as unpopulated. Swapped out pages would have to be swapped in first, so their inner page table isn't collapsed.
+    for (int j = 0; j < PAGES_PER_HUGE_PAGE; j++) {
+        if (inner_page_table[j].swap_slot != -1) {
+            return false;
+        }
+        bool is_populated = inner_page_table[j].valid == 1 && inner_page_table[j].frame_number != zero_frame_number;
+        if (is_populated) {
+            no_of_mapped_pages++;
+        }
+        if (!is_populated || inner_page_table[j].frame_number != inner_page_table[0].frame_number + j) {
+            is_in_place = false;
+        }
+    }
+
+    if (no_of_mapped_pages == 0 || PAGES_PER_HUGE_PAGE - no_of_mapped_pages > HUGE_PAGE_DAEMON_MAX_PTES_NONE) {
+        return false;
+    }
+
+    if (!is_in_place) {
+        int huge_frame_number = find_free_frame_block(PAGES_PER_HUGE_PAGE, PAGES_PER_HUGE_PAGE);
+        if (huge_frame_number == -1) {
+            return false;
+        }
+
+        for (int j = 0; j < PAGES_PER_HUGE_PAGE; j++) {
+            claim_frame(huge_frame_number + j, process);
+            if (inner_page_table[j].valid == 1 && inner_page_table[j].frame_number != zero_frame_number) {
+                copy_frame(huge_frame_number + j, inner_page_table[j].frame_number);
+                release_frame(inner_page_table[j].frame_number);
+                no_of_frames_copied++;
+                charge_cycles(COST_HUGE_PAGE_COPY, FRAME_SIZE * HUGE_PAGE_COPY_COST_PER_BYTE);
+            }
+            else {
+                if (inner_page_table[j].valid == 1) {
+                    release_frame(zero_frame_number);
+                }
+                no_of_bloat_frames++;
+            }
+            set_page_table_entry(process, inner_page_table_no * PAGES_PER_HUGE_PAGE + j, huge_frame_number + j);
+        }
+    }
+
+    map_huge_page(process, inner_page_table_no);
+    tlb_shootdown(process->id, inner_page_table_no * PAGES_PER_HUGE_PAGE, PAGES_PER_HUGE_PAGE);
+    no_of_huge_page_collapses++;
+
+    printf("Huge page daemon collapsed pages %d-%d of process %d into frames %d-%d%s.\n", inner_page_table_no * PAGES_PER_HUGE_PAGE,
+    inner_page_table_no * PAGES_PER_HUGE_PAGE + PAGES_PER_HUGE_PAGE - 1, process->id, inner_page_table[0].frame_number,
+    inner_page_table[0].frame_number + PAGES_PER_HUGE_PAGE - 1, is_in_place ? " (in place)" : "");
+    return true;
+}
+
+
+/**
+ * @brief Turn the outer page table entry of an inner page table whose pages sit in an aligned block of consecutive frames into a huge page mapping. In the cuckoo page tables, the huge page replaces the entries of its small pages.
+ * 
+ * @param process The process whose pages are to be mapped as a huge page.
+ * @param inner_page_table_no The inner page table whose pages make up the huge page.
+ */
+void map_huge_page(struct PCB *process, int inner_page_table_no) {
+    process->huge_pages[inner_page_table_no] = 1;
+    if (process->is_guest) {
+        trap_guest_page_table_write(process, inner_page_table_no * PAGES_PER_HUGE_PAGE);
+    }
+
+    for (int j = 0; j < PAGES_PER_HUGE_PAGE; j++) {
+        cuckoo_page_table_remove(&cuckoo_page_tables[process->id][SMALL_PAGE_SIZE_INDEX], inner_page_table_no * PAGES_PER_HUGE_PAGE + j);
+    }
+    cuckoo_page_table_insert(&cuckoo_page_tables[process->id][HUGE_PAGE_SIZE_INDEX], inner_page_table_no, process->inner_page_tables[inner_page_table_no][0].frame_number);
+    cuckoo_walk_cache_invalidate(process->id, inner_page_table_no);
+}
+
+
+/**
+ * @brief Split a huge page of a process back into small pages. The frames stay where they are, so only the outer page table entry changes (and, in the cuckoo page tables, the huge page entry is replaced by an entry for each small page) and the TLB entry of the huge page is invalidated.
+ * 
+ * @param process The process whose huge page is to be split.
+ * @param inner_page_table_no The inner page table the huge page is mapped by.
+ */
+void split_huge_page(struct PCB *process, int inner_page_table_no) {
+    process->huge_pages[inner_page_table_no] = 0;
+    if (process->is_guest) {
+        trap_guest_page_table_write(process, inner_page_table_no * PAGES_PER_HUGE_PAGE);
+    }
+    tlb_shootdown(process->id, inner_page_table_no * PAGES_PER_HUGE_PAGE, PAGES_PER_HUGE_PAGE);
+    no_of_huge_page_splits++;
+
+    cuckoo_page_table_remove(&cuckoo_page_tables[process->id][HUGE_PAGE_SIZE_INDEX], inner_page_table_no);
+    for (int j = 0; j < PAGES_PER_HUGE_PAGE; j++) {
+        struct page_table_entry *pte = &process->inner_page_tables[inner_page_table_no][j];
+        cuckoo_page_table_insert(&cuckoo_page_tables[process->id][SMALL_PAGE_SIZE_INDEX], inner_page_table_no * PAGES_PER_HUGE_PAGE + j, pte->frame_number);
+    }
+    cuckoo_walk_cache_invalidate(process->id, inner_page_table_no);
+
+    printf("Huge page of process %d at pages %d-%d split into small pages.\n", process->id, inner_page_table_no * PAGES_PER_HUGE_PAGE,
+    inner_page_table_no * PAGES_PER_HUGE_PAGE + PAGES_PER_HUGE_PAGE - 1);
+}
+
+
+/**
+ * @brief Wake up the huge page daemon. It scans the next HUGE_PAGE_DAEMON_TABLES_TO_SCAN inner page tables, continuing from where the last scan stopped and moving on to the next process when a process' inner page tables have all been scanned. Every inner page table that is populated enough is collapsed into a huge page.
+ */
+void run_huge_page_daemon() {
+    for (int i = 0; i < HUGE_PAGE_DAEMON_TABLES_TO_SCAN; i++) {
+        int process_number = huge_page_daemon_cursor / OUTER_PAGE_TABLE_SIZE;
+        int inner_page_table_no = huge_page_daemon_cursor % OUTER_PAGE_TABLE_SIZE;
+
+        huge_page_daemon_cursor = (huge_page_daemon_cursor + 1) % (MAX_PROCESS_COUNT * OUTER_PAGE_TABLE_SIZE);
+
+        if (processes[process_number] == NULL || is_process_exited[process_number] == 1) {
+            continue;
+        }
+
+        no_of_inner_page_tables_scanned++;
+        collapse_huge_page(processes[process_number], inner_page_table_no);
+    }
+}
+
+
+// --- INVERTED PAGE TABLE ---
+
+
+/**
+ * @brief Ask which page table structure the MMU should walk. The two-level page tables are kept up to date either way, since they are what the OS uses to manage a process' pages.
+ */
+void select_page_table_mode() {
+    printf("Which page table should the MMU walk? Enter %d for two-level page tables, %d for an inverted page table or %d for cuckoo hashed page tables\n", PAGE_TABLE_MODE_RADIX, PAGE_TABLE_MODE_INVERTED, PAGE_TABLE_MODE_CUCKOO);
+    scanf("%d", &page_table_mode);
+
+    if (page_table_mode != PAGE_TABLE_MODE_INVERTED && page_table_mode != PAGE_TABLE_MODE_CUCKOO) {
+        page_table_mode = PAGE_TABLE_MODE_RADIX;
+    }
+}
+
+
+/**
+ * @brief Initialize the inverted page table by marking every entry as unmapped, and empty every chain of the hash anchor table.
+ */
+void initialize_inverted_page_table() {
+    for (int i = 0; i < NO_OF_FRAMES; i++) {
+        inverted_page_table[i].process_id = -1;
+        inverted_page_table[i].page_number = -1;
+        inverted_page_table[i].next = -1;
+    }
+
+    for (int i = 0; i < HASH_ANCHOR_TABLE_SIZE; i++) {
+        hash_anchor_table[i] = -1;
+    }
+}
+
+
+/**
+ * @brief Hash a page of a process to a slot of the hash anchor table.
+ * 
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page to be hashed.
+ * @return The slot of the hash anchor table.
+ */
+int hash_page(int process_id, int page_number) {
+    unsigned int key = (unsigned int)(page_number * MAX_PROCESS_COUNT + process_id);
+    return (int)((key * 2654435761u) % HASH_ANCHOR_TABLE_SIZE);
+}
+
+
+/**
+ * @brief Record in the inverted page table that a page of a process is in a frame. The entry is added to the front of its hash chain. A frame has a single entry, so if the frame is shared, the entry of the process that mapped it before is replaced.
+ * 
+ * @param frame_number The frame the page is in.
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page that is in the frame.
+ */
+void inverted_page_table_insert(int frame_number, int process_id, int page_number) {
+    int slot = hash_page(process_id, page_number);
+
+    inverted_page_table_remove(frame_number);
+    inverted_page_table[frame_number].process_id = process_id;
+    inverted_page_table[frame_number].page_number = page_number;
+    inverted_page_table[frame_number].next = hash_anchor_table[slot];
+    hash_anchor_table[slot] = frame_number;
+}
+
+
+/**
+ * @brief Remove the entry of a frame from the inverted page table and unlink it from its hash chain.
+ * 
+ * @param frame_number The frame whose entry is to be removed.
+ */
+void inverted_page_table_remove(int frame_number) {
+    struct inverted_page_table_entry *entry = &inverted_page_table[frame_number];
+
+    if (entry->process_id == -1) {
+        return;
+    }
+
+    int *link = &hash_anchor_table[hash_page(entry->process_id, entry->page_number)];
+    while (*link != -1 && *link != frame_number) {
+        link = &inverted_page_table[*link].next;
+    }
+    if (*link == frame_number) {
+        *link = entry->next;
+    }
+
+    entry->process_id = -1;
+    entry->page_number = -1;
+    entry->next = -1;
+}
+
+
+/**
+ * @brief Translate a page by searching the inverted page table. The page is hashed to a slot of the hash anchor table, and the chain starting there is followed until an entry with the same process id and page number is found. The index of that entry is the frame number. The inverted page table has no notion of huge pages, so every translation covers a single page. A frame shared by several processes only has an entry for one of them. If another one misses, the OS reloads the entry from the process' page tables (an alias fault), as systems with inverted page tables do. The zero frame's entry is reloaded the same way, but isn't counted as an alias fault.
+ * 
+ * @param process The process whose page is to be translated.
+ * @param page_number The page to be translated.
+ * @param translation Filled with the translation if the page is mapped.
+ * @param no_of_references Increased by the number of hash anchor table and inverted page table entries read.
+ * @return true if the page is mapped and false if otherwise.
+ */
+bool walk_inverted_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references) {
+    (*no_of_references)++; // hash anchor table entry
+
+    int frame_number = hash_anchor_table[hash_page(process->id, page_number)];
+
+    while (frame_number != -1) {
+        (*no_of_references)++; // inverted page table entry
+
+        if (inverted_page_table[frame_number].process_id == process->id && inverted_page_table[frame_number].page_number == page_number) {
+            translation->process_id = process->id;
+            translation->page_number = page_number;
+            translation->frame_number = frame_number;
+            translation->no_of_pages = 1;
+            return true;
+        }
+        frame_number = inverted_page_table[frame_number].next;
+    }
+
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+    if (pte->valid == 1) {
+        if (pte->frame_number == zero_frame_number) {
+            no_of_inverted_zero_frame_reloads++;
+        }
+        else {
+            no_of_inverted_alias_faults++;
+        }
+        (*no_of_references)++; // page table entry read by the OS
+        inverted_page_table_insert(pte->frame_number, process->id, page_number);
+
+        translation->process_id = process->id;
+        translation->page_number = page_number;
+        translation->frame_number = pte->frame_number;
+        translation->no_of_pages = 1;
+        return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Measure the memory taken up by the page tables of every process in memory, by the inverted page table and by the cuckoo page tables. The two-level page tables of a process are counted in full (an outer page table entry and an inner page table for each of its entries), and also with only the inner page tables that hold a mapped page. A shared inner page table is only counted once, whichever processes point to it. The inverted page table's size only depends on the number of frames. The cuckoo page tables grow with the number of mapped pages.
+ */
+void measure_page_table_footprint() {
+    radix_page_table_footprint = 0;
+    populated_radix_page_table_footprint = 0;
+
+    for (int i = 0; i < MAX_PROCESS_COUNT; i++) {
+        if (processes[i] == NULL || is_process_exited[i] == 1) {
+            continue;
+        }
+
+        radix_page_table_footprint += OUTER_PAGE_TABLE_SIZE * (PAGE_TABLE_ENTRY_SIZE + PAGE_SIZE);
+        populated_radix_page_table_footprint += OUTER_PAGE_TABLE_SIZE * PAGE_TABLE_ENTRY_SIZE;
+
+        for (int j = 0; j < OUTER_PAGE_TABLE_SIZE; j++) {
+            for (int k = 0; k < NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; k++) {
+                if (shared_inner_page_tables[i][j] == NULL && processes[i]->inner_page_tables[j][k].valid == 1) {
+                    populated_radix_page_table_footprint += PAGE_SIZE;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < NO_OF_SHARED_MEMORY_SEGMENTS; i++) {
+        if (shared_memory_segments[i].has_inner_page_tables == 1) {
+            populated_radix_page_table_footprint += SHARED_MEMORY_INNER_PAGE_TABLES * PAGE_SIZE;
+        }
+    }
+
+    inverted_page_table_footprint = NO_OF_FRAMES * INVERTED_PAGE_TABLE_ENTRY_SIZE + HASH_ANCHOR_TABLE_SIZE * HASH_ANCHOR_TABLE_ENTRY_SIZE;
+
+    cuckoo_page_table_footprint = 0;
+    for (int i = 0; i < MAX_PROCESS_COUNT; i++) {
+        if (processes[i] == NULL || is_process_exited[i] == 1) {
+            continue;
+        }
+        for (int j = 0; j < NO_OF_PAGE_SIZES; j++) {
+            struct cuckoo_page_table *table = &cuckoo_page_tables[i][j];
+            cuckoo_page_table_footprint += CUCKOO_WAYS * table->way_size * CUCKOO_PAGE_TABLE_ENTRY_SIZE;
+            if (table->new_ways[0] != NULL) {
+                cuckoo_page_table_footprint += CUCKOO_WAYS * table->new_way_size * CUCKOO_PAGE_TABLE_ENTRY_SIZE;
+            }
+        }
+    }
+}
+
+
+// --- ELASTIC CUCKOO PAGE TABLES ---
+
+
+/**
+ * @brief Initialize a cuckoo page table with empty ways of CUCKOO_INITIAL_WAY_SIZE slots. Any ways the table already had are freed.
+ * 
+ * @param table The cuckoo page table to be initialized.
+ */
+void initialize_cuckoo_page_table(struct cuckoo_page_table *table) {
+    free_cuckoo_page_table(table);
+
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        table->ways[i] = calloc(CUCKOO_INITIAL_WAY_SIZE, sizeof(struct cuckoo_page_table_entry));
+        if (table->ways[i] == NULL) {
+            fprintf(stderr, "Failed to allocate memory for cuckoo page table\n");
+            exit(EXIT_FAILURE);
+        }
+        table->new_ways[i] = NULL;
+        table->rehash_pointers[i] = 0;
+    }
+    table->way_size = CUCKOO_INITIAL_WAY_SIZE;
+    table->new_way_size = 0;
+    table->no_of_entries = 0;
+}
+
+
+/**
+ * @brief Free the ways of a cuckoo page table, including the new ways if it's being resized.
+ * 
+ * @param table The cuckoo page table to be freed.
+ */
+void free_cuckoo_page_table(struct cuckoo_page_table *table) {
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        free(table->ways[i]);
+        free(table->new_ways[i]);
+        table->ways[i] = NULL;
+        table->new_ways[i] = NULL;
+    }
+    table->way_size = 0;
+}
+
+
+/**
+ * @brief Hash a page number to a slot of a way. Every way uses a different hash function, so two keys that collide in one way are unlikely to collide in another.
+ * 
+ * @param way The way whose hash function is used.
+ * @param page_number The key to be hashed.
+ * @param way_size The number of slots in the way.
+ * @return The slot of the way.
+ */
+int cuckoo_hash(int way, int page_number, int way_size) {
+    static const unsigned int multipliers[] = {2654435761u, 2246822519u, 3266489917u, 668265263u};
+    unsigned int hash = ((unsigned int)page_number + 1u) * multipliers[way % 4];
+    return (int)((hash >> 7) % (unsigned int)way_size);
+}
+
+
+/**
+ * @brief Find the slot a key would occupy in a way. During a resize, if the key's slot in the old way has already been moved (it's below the rehash pointer), its slot in the new way is returned instead.
+ * 
+ * @param table The cuckoo page table.
+ * @param way The way to be searched.
+ * @param page_number The key.
+ * @return A pointer to the slot.
+ */
+struct cuckoo_page_table_entry *get_cuckoo_slot(struct cuckoo_page_table *table, int way, int page_number) {
+    int slot = cuckoo_hash(way, page_number, table->way_size);
+
+    if (table->new_ways[way] != NULL && slot < table->rehash_pointers[way]) {
+        return &table->new_ways[way][cuckoo_hash(way, page_number, table->new_way_size)];
+    }
+    return &table->ways[way][slot];
+}
+
+
+/**
+ * @brief Place an entry in a cuckoo page table. If every way's slot for the entry is taken, the entry displaces the occupant of one of them, and the displaced entry is placed the same way in one of its other ways, up to CUCKOO_MAX_KICKS times.
+ * 
+ * @param table The cuckoo page table.
+ * @param entry The entry to be placed. If placing fails, it's replaced by the entry that was left without a slot.
+ * @return true if every entry found a slot and false if otherwise.
+ */
+bool cuckoo_place(struct cuckoo_page_table *table, struct cuckoo_page_table_entry *entry) {
+    int way = rand() % CUCKOO_WAYS;
+
+    for (int kick = 0; kick <= CUCKOO_MAX_KICKS; kick++) {
+        for (int i = 0; i < CUCKOO_WAYS; i++) {
+            struct cuckoo_page_table_entry *slot = get_cuckoo_slot(table, i, entry->page_number);
+            if (slot->valid == 0) {
+                *slot = *entry;
+                return true;
+            }
+        }
+
+        // Every slot is taken. Displace the occupant of one of them, and move on to one of its other ways.
+        struct cuckoo_page_table_entry *slot = get_cuckoo_slot(table, way, entry->page_number);
+        struct cuckoo_page_table_entry displaced_entry = *slot;
+        *slot = *entry;
+        *entry = displaced_entry;
+        no_of_cuckoo_kicks++;
+
+        way = (way + 1 + rand() % (CUCKOO_WAYS - 1)) % CUCKOO_WAYS;
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Place an entry in a cuckoo page table, growing the table at once if there is no slot for it. Growing at once stalls translation, so it's counted separately from gradual resizes.
+ * 
+ * @param table The cuckoo page table.
+ * @param entry The entry to be placed.
+ */
+void cuckoo_place_or_grow(struct cuckoo_page_table *table, struct cuckoo_page_table_entry entry) {
+    while (!cuckoo_place(table, &entry)) {
+        no_of_cuckoo_resize_stalls++;
+        if (table->new_ways[0] == NULL) {
+            start_cuckoo_resize(table);
+        }
+        finish_cuckoo_resize(table);
+    }
+}
+
+
+/**
+ * @brief Start a gradual resize of a cuckoo page table. New ways of double the size are allocated and the rehash pointers are reset. Entries are moved into the new ways a few slots at a time by later insertions, so the table never has to stop serving lookups.
+ * 
+ * @param table The cuckoo page table to be resized.
+ */
+void start_cuckoo_resize(struct cuckoo_page_table *table) {
+    table->new_way_size = table->way_size * 2;
+
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        table->new_ways[i] = calloc((size_t)table->new_way_size, sizeof(struct cuckoo_page_table_entry));
+        if (table->new_ways[i] == NULL) {
+            fprintf(stderr, "Failed to allocate memory for cuckoo page table\n");
+            exit(EXIT_FAILURE);
+        }
+        table->rehash_pointers[i] = 0;
+    }
+    no_of_cuckoo_resizes++;
+}
+
+
+/**
+ * @brief Move the next slots of every old way into the new ways. Once every old way has been moved, the old ways are freed and the new ways take their place.
+ * 
+ * @param table The cuckoo page table being resized.
+ * @param no_of_slots The number of slots of each old way to be moved.
+ */
+void migrate_cuckoo_slots(struct cuckoo_page_table *table, int no_of_slots) {
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        for (int j = 0; j < no_of_slots && table->new_ways[i] != NULL && table->rehash_pointers[i] < table->way_size; j++) {
+            struct cuckoo_page_table_entry entry = table->ways[i][table->rehash_pointers[i]];
+            table->ways[i][table->rehash_pointers[i]].valid = 0;
+            table->rehash_pointers[i]++;
+
+            // Moving the rehash pointer past the slot makes the entry's slot in this way a slot of the new way
+            if (entry.valid == 1) {
+                cuckoo_place_or_grow(table, entry);
+            }
+        }
+    }
+
+    if (table->new_ways[0] == NULL) {
+        return; // the resize was finished while placing an entry
+    }
+
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        if (table->rehash_pointers[i] < table->way_size) {
+            return;
+        }
+    }
+
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        free(table->ways[i]);
+        table->ways[i] = table->new_ways[i];
+        table->new_ways[i] = NULL;
+        table->rehash_pointers[i] = 0;
+    }
+    table->way_size = table->new_way_size;
+}
+
+
+/**
+ * @brief Finish a resize at once by moving every slot that hasn't been moved yet.
+ * 
+ * @param table The cuckoo page table being resized.
+ */
+void finish_cuckoo_resize(struct cuckoo_page_table *table) {
+    migrate_cuckoo_slots(table, table->way_size);
+}
+
+
+/**
+ * @brief Insert a mapping into a cuckoo page table. If the table is being resized, the insertion also moves CUCKOO_SLOTS_MIGRATED_PER_INSERT slots of every old way. If it isn't, and its occupancy has reached CUCKOO_RESIZE_THRESHOLD, a resize is started.
+ * 
+ * @param table The cuckoo page table.
+ * @param page_number The key of the mapping.
+ * @param frame_number The frame the key maps on to.
+ */
+void cuckoo_page_table_insert(struct cuckoo_page_table *table, int page_number, int frame_number) {
+    struct cuckoo_page_table_entry entry = {1, page_number, frame_number};
+
+    if (table->new_ways[0] != NULL) {
+        migrate_cuckoo_slots(table, CUCKOO_SLOTS_MIGRATED_PER_INSERT);
+    }
+
+    cuckoo_place_or_grow(table, entry);
+    table->no_of_entries++;
+
+    if (table->new_ways[0] == NULL && table->no_of_entries * 100 >= CUCKOO_RESIZE_THRESHOLD * CUCKOO_WAYS * table->way_size) {
+        start_cuckoo_resize(table);
+    }
+}
+
+
+/**
+ * @brief Remove a mapping from a cuckoo page table, if the table has it.
+ * 
+ * @param table The cuckoo page table.
+ * @param page_number The key of the mapping.
+ */
+void cuckoo_page_table_remove(struct cuckoo_page_table *table, int page_number) {
+    struct cuckoo_page_table_entry *entry = cuckoo_page_table_lookup(table, page_number);
+
+    if (entry != NULL) {
+        entry->valid = 0;
+        table->no_of_entries--;
+    }
+}
+
+
+/**
+ * @brief Look up a key in a cuckoo page table. One slot is read in each way, and a key can only be in one of those slots.
+ * 
+ * @param table The cuckoo page table.
+ * @param page_number The key.
+ * @return A pointer to the entry with the key, or NULL if the table doesn't have it.
+ */
+struct cuckoo_page_table_entry *cuckoo_page_table_lookup(struct cuckoo_page_table *table, int page_number) {
+    for (int i = 0; i < CUCKOO_WAYS; i++) {
+        struct cuckoo_page_table_entry *slot = get_cuckoo_slot(table, i, page_number);
+        if (slot->valid == 1 && slot->page_number == page_number) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Find out which page sizes are mapped in the span of pages covered by an inner page table of a process. The cuckoo walk cache is searched first. On a miss, the span is looked up in the cuckoo page table of every page size (the huge page, and each of its small pages), and the result is cached. The probes don't depend on each other, so they take one dependent step.
+ * 
+ * @param process The process whose span is looked up.
+ * @param inner_page_table_no The span, identified by the inner page table that covers it.
+ * @param no_of_references Increased by the number of memory references made.
+ * @param no_of_steps Increased by the number of dependent memory steps made.
+ * @return A bit for each page size mapped in the span.
+ */
+int cuckoo_walk_cache_lookup(struct PCB *process, int inner_page_table_no, int *no_of_references, int *no_of_steps) {
+    int victim = 0;
+
+    for (int i = 0; i < CUCKOO_WALK_CACHE_SIZE; i++) {
+        struct cuckoo_walk_cache_entry *entry = &cuckoo_walk_cache[i];
+        if (entry->valid == 1 && entry->process_id == process->id && entry->inner_page_table_no == inner_page_table_no) {
+            entry->last_used = tlb_clock;
+            no_of_cuckoo_walk_cache_hits++;
+            return entry->page_sizes;
+        }
+        if (cuckoo_walk_cache[victim].valid == 1 && (entry->valid == 0 || entry->last_used < cuckoo_walk_cache[victim].last_used)) {
+            victim = i;
+        }
+    }
+
+    no_of_cuckoo_walk_cache_misses++;
+    (*no_of_references) += CUCKOO_WAYS * (1 + PAGES_PER_HUGE_PAGE);
+    (*no_of_steps)++;
+
+    int page_sizes = 0;
+    if (cuckoo_page_table_lookup(&cuckoo_page_tables[process->id][HUGE_PAGE_SIZE_INDEX], inner_page_table_no) != NULL) {
+        page_sizes |= 1 << HUGE_PAGE_SIZE_INDEX;
+    }
+    for (int j = 0; j < PAGES_PER_HUGE_PAGE; j++) {
+        if (cuckoo_page_table_lookup(&cuckoo_page_tables[process->id][SMALL_PAGE_SIZE_INDEX], inner_page_table_no * PAGES_PER_HUGE_PAGE + j) != NULL) {
+            page_sizes |= 1 << SMALL_PAGE_SIZE_INDEX;
+        }
+    }
+
+    struct cuckoo_walk_cache_entry new_entry = {1, process->id, inner_page_table_no, page_sizes, tlb_clock};
+    cuckoo_walk_cache[victim] = new_entry;
+    return page_sizes;
+}
+
+
+/**
+ * @brief Invalidate the cuckoo walk cache entry of a span of pages of a process. This is done whenever a mapping in the span changes.
+ * 
+ * @param process_id The id of the process the span belongs to.
+ * @param inner_page_table_no The span, identified by the inner page table that covers it.
+ */
+void cuckoo_walk_cache_invalidate(int process_id, int inner_page_table_no) {
+    for (int i = 0; i < CUCKOO_WALK_CACHE_SIZE; i++) {
+        if (cuckoo_walk_cache[i].process_id == process_id && cuckoo_walk_cache[i].inner_page_table_no == inner_page_table_no) {
+            cuckoo_walk_cache[i].valid = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Translate a page by looking it up in the cuckoo page tables of a process. The cuckoo walk cache tells which page size tables may hold the page, and every way of those tables is probed in parallel. Unlike the two-level walk, no probe depends on another, so the walk takes a single step (two on a cuckoo walk cache miss) however many ways are probed.
+ * 
+ * @param process The process whose page is to be translated.
+ * @param page_number The page to be translated.
+ * @param translation Filled with the translation if the page is mapped. For a huge page, it covers the whole huge page.
+ * @param no_of_references Increased by the number of slots read, cuckoo walk cache refills included.
+ * @return true if the page is mapped and false if otherwise.
+ */
+bool walk_cuckoo_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references) {
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    int no_of_steps = 0;
+
+    int page_sizes = cuckoo_walk_cache_lookup(process, inner_page_table_no, no_of_references, &no_of_steps);
+
+    struct cuckoo_page_table_entry *entry = NULL;
+    translation->process_id = process->id;
+
+    if (page_sizes != 0) {
+        no_of_steps++;
+    }
+
+    if (page_sizes & (1 << HUGE_PAGE_SIZE_INDEX)) {
+        *no_of_references += CUCKOO_WAYS;
+        entry = cuckoo_page_table_lookup(&cuckoo_page_tables[process->id][HUGE_PAGE_SIZE_INDEX], inner_page_table_no);
+        if (entry != NULL) {
+            translation->page_number = inner_page_table_no * PAGES_PER_HUGE_PAGE;
+            translation->frame_number = entry->frame_number;
+            translation->no_of_pages = PAGES_PER_HUGE_PAGE;
+        }
+    }
+
+    if (page_sizes & (1 << SMALL_PAGE_SIZE_INDEX)) {
+        *no_of_references += CUCKOO_WAYS;
+        entry = cuckoo_page_table_lookup(&cuckoo_page_tables[process->id][SMALL_PAGE_SIZE_INDEX], page_number);
+        if (entry != NULL) {
+            translation->page_number = page_number;
+            translation->frame_number = entry->frame_number;
+            translation->no_of_pages = 1;
+        }
+    }
+
+    no_of_cuckoo_walk_steps += no_of_steps;
+    return entry != NULL;
+}
+
+
+// --- RANGE TRANSLATION ---
+
+
+/**
+ * @brief Rebuild the range table of a process from its page tables. Every run of at least MIN_RANGE_PAGES consecutive pages that map on to consecutive frames becomes a range.
+ * 
+ * @param process The process whose range table is to be rebuilt.
+ */
+void build_range_table(struct PCB *process) {
+    struct range_table *table = &range_tables[process->id];
+    table->no_of_ranges = 0;
+
+    int page_number = 0;
+    while (page_number < NO_OF_PAGES) {
+        struct page_table_entry *pte = get_page_table_entry(process, page_number);
+        if (pte->valid == 0) {
+            page_number++;
+            continue;
+        }
+
+        int limit = page_number + 1;
+        while (limit < NO_OF_PAGES && get_page_table_entry(process, limit)->valid == 1
+        && get_page_table_entry(process, limit)->frame_number == pte->frame_number + (limit - page_number)) {
+            limit++;
+        }
+
+        if (limit - page_number >= MIN_RANGE_PAGES) {
+            struct range_table_entry range = {page_number, limit, pte->frame_number - page_number};
+            table->ranges[table->no_of_ranges] = range;
+            table->no_of_ranges++;
+        }
+        page_number = limit;
+    }
+
+    table->is_stale = 0;
+}
+
+
+/**
+ * @brief Walk the range table of a process to find the range a page is in. The range table is sorted by base, so it's binary searched, reading one range per step.
+ * 
+ * @param process The process whose range table is walked.
+ * @param page_number The page whose range is to be found.
+ * @param range Filled with the range if the page is in one.
+ * @return true if the page is in a range and false if otherwise.
+ */
+bool walk_range_table(struct PCB *process, int page_number, struct range_table_entry *range) {
+    struct range_table *table = &range_tables[process->id];
+
+    if (table->is_stale == 1) {
+        build_range_table(process);
+    }
+
+    no_of_range_table_walks++;
+
+    int low = 0;
+    int high = table->no_of_ranges - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        no_of_range_table_walk_references++;
+
+        if (page_number < table->ranges[middle].base) {
+            high = middle - 1;
+        }
+        else if (page_number >= table->ranges[middle].limit) {
+            low = middle + 1;
+        }
+        else {
+            *range = table->ranges[middle];
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Find the direct segment of a process. It's the process' largest range, held in registers loaded when the process is scheduled, so using it costs no memory references.
+ * 
+ * @param process The process whose direct segment is to be found.
+ * @return A pointer to the direct segment, or NULL if the process has no range.
+ */
+struct range_table_entry *get_direct_segment(struct PCB *process) {
+    struct range_table *table = &range_tables[process->id];
+
+    if (table->is_stale == 1) {
+        build_range_table(process);
+    }
+
+    struct range_table_entry *direct_segment = NULL;
+    for (int i = 0; i < table->no_of_ranges; i++) {
+        if (direct_segment == NULL || table->ranges[i].limit - table->ranges[i].base > direct_segment->limit - direct_segment->base) {
+            direct_segment = &table->ranges[i];
+        }
+    }
+    return direct_segment;
+}
+
+
+/**
+ * @brief Look up the range a page is in, in the range TLB. Every entry is compared at once, since the range TLB is fully associative.
+ * 
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page to be translated.
+ * @return A pointer to the entry whose range holds the page, or NULL if there is none.
+ */
+struct range_tlb_entry *range_tlb_lookup(int process_id, int page_number) {
+    for (int i = 0; i < RANGE_TLB_SIZE; i++) {
+        struct range_tlb_entry *entry = &range_tlb[i];
+        if (entry->valid == 1 && entry->process_id == process_id && page_number >= entry->range.base && page_number < entry->range.limit) {
+            entry->last_used = tlb_clock;
+            no_of_range_tlb_hits++;
+            return entry;
+        }
+    }
+
+    no_of_range_tlb_misses++;
+    return NULL;
+}
+
+
+/**
+ * @brief Insert a range into the range TLB. If the range TLB is full, the least recently used entry is replaced.
+ * 
+ * @param process_id The id of the process the range belongs to.
+ * @param range The range to be inserted.
+ */
+void range_tlb_insert(int process_id, struct range_table_entry range) {
+    int victim = 0;
+
+    for (int i = 0; i < RANGE_TLB_SIZE; i++) {
+        if (range_tlb[i].valid == 0) {
+            victim = i;
+            break;
+        }
+        if (range_tlb[i].last_used < range_tlb[victim].last_used) {
+            victim = i;
+        }
+    }
+
+    struct range_tlb_entry entry = {1, process_id, range, tlb_clock};
+    range_tlb[victim] = entry;
+}
+
+
+/**
+ * @brief Invalidate the range TLB entry whose range holds a page of a process. This is done whenever the page's mapping changes.
+ * 
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page whose mapping changed.
+ */
+void range_tlb_invalidate(int process_id, int page_number) {
+    for (int i = 0; i < RANGE_TLB_SIZE; i++) {
+        struct range_tlb_entry *entry = &range_tlb[i];
+        if (entry->valid == 1 && entry->process_id == process_id && page_number >= entry->range.base && page_number < entry->range.limit) {
+            entry->valid = 0;
+        }
+    }
+}
+
+
+// --- TLB PREFETCHING ---
+
+
+/**
+ * @brief Initialize the TLB prefetcher by emptying the prefetch buffer and the distance table, and forgetting every process' last TLB miss.
+ */
+void initialize_tlb_prefetcher() {
+    for (int i = 0; i < PREFETCH_BUFFER_SIZE; i++) {
+        prefetch_buffer[i].valid = 0;
+    }
+
+    for (int i = 0; i < DISTANCE_TABLE_SIZE; i++) {
+        distance_table[i].valid = 0;
+    }
+
+    for (int i = 0; i < MAX_PROCESS_COUNT; i++) {
+        last_tlb_miss_pages[i] = -1;
+        last_tlb_miss_distances[i] = 0;
+    }
+}
+
+
+/**
+ * @brief Take the translation of a page out of the prefetch buffer, if the prefetcher brought it in.
+ * 
+ * @param process_id The id of the process the page belongs to.
+ * @param page_number The page that missed in the TLB.
+ * @param translation Filled with the prefetched translation if there is one.
+ * @return true if the prefetch buffer held the translation and false if otherwise.
+ */
+bool prefetch_buffer_take(int process_id, int page_number, struct tlb_entry *translation) {
+    for (int i = 0; i < PREFETCH_BUFFER_SIZE; i++) {
+        struct tlb_entry *entry = &prefetch_buffer[i];
+        if (entry->valid == 1 && entry->process_id == process_id && page_number >= entry->page_number && page_number < entry->page_number + entry->no_of_pages) {
+            *translation = *entry;
+            entry->valid = 0;
+            no_of_useful_prefetches++;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Prefetch the translation of a page into the prefetch buffer by walking the page table. Nothing is done if the page is outside virtual memory or its translation is already cached, and a page that isn't mapped is not faulted in. The prefetch buffer is a FIFO: the oldest prefetch is replaced.
+ * 
+ * @param process The process the page belongs to.
+ * @param page_number The page to be prefetched.
+ */
+void prefetch_translation(struct PCB *process, int page_number) {
+    static int next_slot = 0;
+
+    if (page_number < 0 || page_number >= NO_OF_PAGES) {
+        return;
+    }
+    if (is_page_in_tlb_entries(tlb.entries, TLB_SIZE, process->id, page_number) || is_page_in_tlb_entries(prefetch_buffer, PREFETCH_BUFFER_SIZE, process->id, page_number)) {
+        return;
+    }
+
+    struct tlb_entry translation;
+    no_of_prefetch_walks++;
+    if (!walk_page_table(process, page_number, &translation)) {
+        return;
+    }
+
+    translation.valid = 1;
+    translation.last_used = tlb_clock;
+    prefetch_buffer[next_slot] = translation;
+    next_slot = (next_slot + 1) % PREFETCH_BUFFER_SIZE;
+    no_of_prefetches++;
+}
+
+
+/**
+ * @brief Let the TLB prefetcher learn from a TLB miss and prefetch the pages it predicts will miss next. The sequential prefetcher predicts the next page. The stride prefetcher predicts one stride ahead once two consecutive misses of the process were the same distance apart, and again whenever the page it last missed on misses once more. The distance prefetcher records which distance followed the process' previous distance, and predicts using the distances that followed the current one before.
+ * 
+ * @param process The process that missed in the TLB.
+ * @param page_number The page that missed.
+ */
+void train_tlb_prefetcher(struct PCB *process, int page_number) {
+    int last_page_number = last_tlb_miss_pages[process->id];
+    int distance = last_page_number == -1 ? 0 : page_number - last_page_number;
+    int last_distance = last_tlb_miss_distances[process->id];
+
+    // Another miss on the same page (its entry was evicted by other processes' misses) says nothing about the access pattern
+    if (distance != 0 || last_page_number == -1) {
+        last_tlb_miss_pages[process->id] = page_number;
+        last_tlb_miss_distances[process->id] = distance;
+    }
+
+    if (TLB_PREFETCHER == TLB_PREFETCHER_SEQUENTIAL) {
+        prefetch_translation(process, page_number + 1);
+    }
+    else if (TLB_PREFETCHER == TLB_PREFETCHER_STRIDE) {
+        if (distance != 0 && distance == last_distance) {
+            prefetch_translation(process, page_number + distance);
+        }
+        else if (distance == 0 && last_distance != 0) {
+            prefetch_translation(process, page_number + last_distance);
+        }
+    }
+    else if (TLB_PREFETCHER == TLB_PREFETCHER_DISTANCE) {
+        if (last_distance != 0 && distance != 0) {
+            update_distance_table(last_distance, distance);
+        }
+
+        struct distance_table_entry *entry = find_distance_table_entry(distance);
+        if (distance != 0 && entry != NULL) {
+            for (int i = 0; i < DISTANCE_PREDICTIONS; i++) {
+                if (entry->next_distances[i] != 0) {
+                    prefetch_translation(process, page_number + entry->next_distances[i]);
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Record in the distance table that a distance between TLB misses was followed by another distance. The most recent following distance is kept first. If the distance has no entry and the table is full, the least recently used entry is replaced.
+ * 
+ * @param distance The earlier distance.
+ * @param next_distance The distance that followed it.
+ */
+void update_distance_table(int distance, int next_distance) {
+    struct distance_table_entry *entry = find_distance_table_entry(distance);
+
+    if (entry == NULL) {
+        entry = &distance_table[0];
+        for (int i = 0; i < DISTANCE_TABLE_SIZE; i++) {
+            if (distance_table[i].valid == 0) {
+                entry = &distance_table[i];
+                break;
+            }
+            if (distance_table[i].last_used < entry->last_used) {
+                entry = &distance_table[i];
+            }
+        }
+
+        entry->valid = 1;
+        entry->distance = distance;
+        for (int i = 0; i < DISTANCE_PREDICTIONS; i++) {
+            entry->next_distances[i] = 0;
+        }
+    }
+
+    int i = 0;
+    while (i < DISTANCE_PREDICTIONS - 1 && entry->next_distances[i] != next_distance) {
+        i++;
+    }
+    for (; i > 0; i--) {
+        entry->next_distances[i] = entry->next_distances[i - 1];
+    }
+    entry->next_distances[0] = next_distance;
+    entry->last_used = tlb_clock;
+}
+
+
+/**
+ * @brief Find the entry of a distance in the distance table.
+ * 
+ * @param distance The distance.
+ * @return A pointer to the entry, or NULL if the distance has no entry.
+ */
+struct distance_table_entry *find_distance_table_entry(int distance) {
+    for (int i = 0; i < DISTANCE_TABLE_SIZE; i++) {
+        if (distance_table[i].valid == 1 && distance_table[i].distance == distance) {
+            distance_table[i].last_used = tlb_clock;
+            return &distance_table[i];
+        }
+    }
+    return NULL;
+}
+
+
+// --- NESTED PAGING ---
+
+
+/**
+ * @brief Initialize the host page table of a process. The guest-physical frames holding the guest's page tables are mapped on to hypervisor memory. The data frames are unmapped until the guest uses them.
+ * 
+ * @param process The process whose host page table is to be initialized.
+ */
+void initialize_host_page_table(struct PCB *process) {
+    for (int i = 0; i < GUEST_PHYSICAL_FRAMES; i++) {
+        struct page_table_entry *host_pte = get_host_page_table_entry(process, i);
+        host_pte->frame_number = i < GUEST_DATA_FRAMES ? -1 : HYPERVISOR_FRAME;
+        host_pte->valid = i >= GUEST_DATA_FRAMES;
+        host_pte->guest_frame_number = -1;
+    }
+
+    for (int i = 0; i < NESTED_WALK_CACHE_SIZE; i++) {
+        if (nested_walk_cache[i].process_id == process->id) {
+            nested_walk_cache[i].valid = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Get the entry of a guest-physical frame in the host page table of a process.
+ * 
+ * @param process The guest process.
+ * @param guest_frame_number The guest-physical frame.
+ * @return A pointer to the host page table entry.
+ */
+struct page_table_entry *get_host_page_table_entry(struct PCB *process, int guest_frame_number) {
+    return &host_page_tables[process->id][guest_frame_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE][guest_frame_number % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+}
+
+
+/**
+ * @brief Give a frame of a guest process a guest-physical frame, using the first-fit algorithm, and map it on to the frame in the guest's host page table.
+ * 
+ * @param process The guest process.
+ * @param frame_number The frame the guest was given.
+ * @return The guest-physical frame number. It's -1 if the guest has no free guest-physical frame, which can't happen since it has one for every page.
+ */
+int allocate_guest_frame(struct PCB *process, int frame_number) {
+    for (int i = 0; i < GUEST_DATA_FRAMES; i++) {
+        struct page_table_entry *host_pte = get_host_page_table_entry(process, i);
+        if (host_pte->valid == 0) {
+            host_pte->frame_number = frame_number;
+            host_pte->valid = 1;
+            nested_walk_cache_invalidate(process->id, i);
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Unmap a guest-physical frame of a guest process from its host page table.
+ * 
+ * @param process The guest process.
+ * @param guest_frame_number The guest-physical frame to be unmapped.
+ */
+void free_guest_frame(struct PCB *process, int guest_frame_number) {
+    if (guest_frame_number < 0) {
+        return;
+    }
+
+    struct page_table_entry *host_pte = get_host_page_table_entry(process, guest_frame_number);
+    host_pte->frame_number = -1;
+    host_pte->valid = 0;
+    nested_walk_cache_invalidate(process->id, guest_frame_number);
+}
+
+
+/**
+ * @brief Translate a guest-physical frame of a guest process to a frame. The nested walk cache is searched first. On a miss, the host page table is walked (its outer entry, then its inner entry) and the translation is cached.
+ * 
+ * @param process The guest process.
+ * @param guest_frame_number The guest-physical frame to be translated.
+ * @param no_of_references Increased by the number of host page table entries read.
+ * @return The frame. It's -1 if the guest-physical frame isn't mapped.
+ */
+int translate_guest_frame(struct PCB *process, int guest_frame_number, int *no_of_references) {
+    int victim = 0;
+
+    for (int i = 0; i < NESTED_WALK_CACHE_SIZE; i++) {
+        struct nested_walk_cache_entry *entry = &nested_walk_cache[i];
+        if (entry->valid == 1 && entry->process_id == process->id && entry->guest_frame_number == guest_frame_number) {
+            entry->last_used = tlb_clock;
+            no_of_nested_walk_cache_hits++;
+            return entry->frame_number;
+        }
+        if (nested_walk_cache[victim].valid == 1 && (entry->valid == 0 || entry->last_used < nested_walk_cache[victim].last_used)) {
+            victim = i;
+        }
+    }
+
+    no_of_nested_walk_cache_misses++;
+    *no_of_references += 2; // host outer page table entry, then host inner page table entry
+
+    struct page_table_entry *host_pte = get_host_page_table_entry(process, guest_frame_number);
+    if (host_pte->valid == 0) {
+        return -1;
+    }
+
+    struct nested_walk_cache_entry new_entry = {1, process->id, guest_frame_number, host_pte->frame_number, tlb_clock};
+    nested_walk_cache[victim] = new_entry;
+    return host_pte->frame_number;
+}
+
+
+/**
+ * @brief Invalidate the nested walk cache entry of a guest-physical frame. This is done whenever the host page table entry of the frame changes.
+ * 
+ * @param process_id The id of the guest process.
+ * @param guest_frame_number The guest-physical frame.
+ */
+void nested_walk_cache_invalidate(int process_id, int guest_frame_number) {
+    for (int i = 0; i < NESTED_WALK_CACHE_SIZE; i++) {
+        if (nested_walk_cache[i].process_id == process_id && nested_walk_cache[i].guest_frame_number == guest_frame_number) {
+            nested_walk_cache[i].valid = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Walk the page tables of a guest process in two dimensions. The guest's outer page table is in a guest-physical frame, so that frame is translated through the host page table before its entry is read. The same goes for the guest's inner page table, and finally for the guest-physical frame of the page itself. The resulting translation goes straight from the page to the frame, so the TLB entry made from it skips both dimensions. The host has no huge pages, so for a guest huge page only the frame of the page being accessed is translated.
+ * 
+ * @param process The guest process whose page is to be translated.
+ * @param page_number The page to be translated.
+ * @param translation Filled with the translation if the page is mapped.
+ * @param no_of_references Increased by the number of guest and host page table entries read.
+ * @return true if the page is mapped and false if otherwise.
+ */
+bool walk_nested_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references) {
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    int no_of_walk_references = 0;
+    bool is_mapped = false;
+
+    translate_guest_frame(process, GUEST_DATA_FRAMES + OUTER_PAGE_TABLE_SIZE, &no_of_walk_references); // guest-physical frame of the guest outer page table
+    no_of_walk_references++; // guest outer page table entry
+
+    translation->process_id = process->id;
+
+    if (process->huge_pages[inner_page_table_no] == 0) {
+        translate_guest_frame(process, GUEST_DATA_FRAMES + inner_page_table_no, &no_of_walk_references); // guest-physical frame of the guest inner page table
+        no_of_walk_references++; // guest inner page table entry
+    }
+
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+    if (pte->valid == 1) {
+        int frame_number = translate_guest_frame(process, pte->guest_frame_number, &no_of_walk_references);
+        if (frame_number != -1) {
+            translation->page_number = page_number;
+            translation->frame_number = frame_number;
+            translation->no_of_pages = 1;
+            is_mapped = true;
+        }
+    }
+
+    no_of_nested_walks++;
+    no_of_nested_walk_references += no_of_walk_references;
+    nested_walk_reference_counts[no_of_walk_references]++;
+    *no_of_references += no_of_walk_references;
+    return is_mapped;
+}
+
+
+// --- SHADOW PAGING ---
+
+
+/**
+ * @brief Initialize the shadow page table of a process by marking every entry as invalid.
+ * 
+ * @param process The process whose shadow page table is to be initialized.
+ */
+void initialize_shadow_page_table(struct PCB *process) {
+    for (int i = 0; i < OUTER_PAGE_TABLE_SIZE; i++) {
+        for (int j = 0; j < NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; j++) {
+            shadow_page_tables[process->id][i][j].frame_number = -1;
+            shadow_page_tables[process->id][i][j].valid = 0;
+            shadow_page_tables[process->id][i][j].guest_frame_number = -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Handle the trap caused by a guest process writing to its page table. The guest's page tables are write-protected under shadow paging, so the hypervisor gets control and synchronizes the shadow page table entries covering the written guest entry. A guest outer page table entry covers a whole inner page table. Each shadow entry is rebuilt by combining the guest entry with the host page table entry of its guest-physical frame.
+ * 
+ * @param process The guest process.
+ * @param page_number The page whose guest page table entry was written. For an outer page table entry, the first page it covers.
+ */
+void trap_guest_page_table_write(struct PCB *process, int page_number) {
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    int first_page = page_number;
+    int no_of_pages = 1;
+
+    no_of_shadow_page_table_traps++;
+    if (VIRTUALIZATION_MODE == VIRTUALIZATION_MODE_SHADOW) {
+        charge_cycles(COST_SHADOW_PAGING, SHADOW_PAGE_TABLE_TRAP_COST);
+    }
+
+    if (process->huge_pages[inner_page_table_no] == 1) {
+        first_page = inner_page_table_no * PAGES_PER_HUGE_PAGE;
+        no_of_pages = PAGES_PER_HUGE_PAGE;
+    }
+
+    for (int i = first_page; i < first_page + no_of_pages; i++) {
+        struct page_table_entry *pte = get_page_table_entry(process, i);
+        struct page_table_entry *shadow_pte = &shadow_page_tables[process->id][i / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE][i % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+
+        shadow_pte->valid = 0;
+        shadow_pte->writable = 0;
+        shadow_pte->frame_number = -1;
+        if (pte->valid == 1 && get_host_page_table_entry(process, pte->guest_frame_number)->valid == 1) {
+            shadow_pte->frame_number = get_host_page_table_entry(process, pte->guest_frame_number)->frame_number;
+            shadow_pte->valid = 1;
+            shadow_pte->writable = pte->writable;
+        }
+        no_of_shadow_page_table_syncs++;
+        if (VIRTUALIZATION_MODE == VIRTUALIZATION_MODE_SHADOW) {
+            charge_cycles(COST_SHADOW_PAGING, SHADOW_PAGE_TABLE_SYNC_COST);
+        }
+    }
+}
+
+
+/**
+ * @brief Walk the shadow page table of a guest process. It maps the guest's pages straight on to frames, so it's walked like a native two-level page table. The host has no huge pages, so the shadow page table only has small pages.
+ * 
+ * @param process The guest process whose page is to be translated.
+ * @param page_number The page to be translated.
+ * @param translation Filled with the translation if the page is mapped.
+ * @param no_of_references Increased by the number of shadow page table entries read.
+ * @return true if the page is mapped and false if otherwise.
+ */
+bool walk_shadow_page_table(struct PCB *process, int page_number, struct tlb_entry *translation, int *no_of_references) {
+    struct page_table_entry *shadow_pte = &shadow_page_tables[process->id][page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE][page_number % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+
+    no_of_shadow_walks++;
+    no_of_shadow_walk_references += 2; // shadow outer page table entry, then shadow inner page table entry
+    *no_of_references += 2;
+
+    if (shadow_pte->valid == 0) {
+        return false;
+    }
+
+    translation->process_id = process->id;
+    translation->page_number = page_number;
+    translation->frame_number = shadow_pte->frame_number;
+    translation->no_of_pages = 1;
+    return true;
+}
+
+
+// --- IOMMU ---
+
+
+/**
+ * @brief Initialize the IOMMU by unmapping every I/O virtual page of every device, emptying the IOTLB and the invalidation queue.
+ */
+void initialize_iommu() {
+    for (int i = 0; i < NO_OF_DMA_DEVICES; i++) {
+        for (int j = 0; j < IO_VIRTUAL_PAGES; j++) {
+            struct page_table_entry *io_pte = get_io_page_table_entry(i, j);
+            io_pte->frame_number = -1;
+            io_pte->valid = 0;
+            io_pte->guest_frame_number = -1;
+            dma_devices[i].is_io_page_pending[j] = 0;
+        }
+    }
+
+    initialize_tlb(&iotlb);
+    invalidation_queue_length = 0;
+}
+
+
+/**
+ * @brief Get the entry of an I/O virtual page in a device's I/O page table.
+ * 
+ * @param device_id The device.
+ * @param io_page_number The I/O virtual page.
+ * @return A pointer to the I/O page table entry.
+ */
+struct page_table_entry *get_io_page_table_entry(int device_id, int io_page_number) {
+    return &dma_devices[device_id].io_page_tables[io_page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE][io_page_number % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+}
+
+
+/**
+ * @brief Map an I/O buffer for a device. Frames for the buffer are taken from the frame allocator on behalf of the process doing the I/O, and pinned until the buffer is unmapped. The first run of free I/O virtual pages long enough for the buffer is mapped on to them. In lazy mode, pages whose invalidation is still queued aren't free yet.
+ * 
+ * @param device_id The device doing the I/O.
+ * @param process The process the I/O is for.
+ * @param no_of_pages The size of the buffer in pages.
+ * @return The first I/O virtual page of the buffer. It's -1 if there weren't enough free frames or I/O virtual pages.
+ */
+int dma_map(int device_id, struct PCB *process, int no_of_pages) {
+    int io_page_number = -1;
+
+    for (int i = 0; i + no_of_pages <= IO_VIRTUAL_PAGES && io_page_number == -1; i++) {
+        int j = 0;
+        while (j < no_of_pages && get_io_page_table_entry(device_id, i + j)->valid == 0 && dma_devices[device_id].is_io_page_pending[i + j] == 0) {
+            j++;
+        }
+        if (j == no_of_pages) {
+            io_page_number = i;
+        }
+    }
+
+    int frame_number = find_free_frame_block(no_of_pages, 1);
+    if (io_page_number == -1 || frame_number == -1) {
+        return -1;
+    }
+
+    for (int i = 0; i < no_of_pages; i++) {
+        claim_frame(frame_number + i, process);
+        no_of_pinned_frames++;
+
+        struct page_table_entry *io_pte = get_io_page_table_entry(device_id, io_page_number + i);
+        io_pte->frame_number = frame_number + i;
+        io_pte->valid = 1;
+        iommu_map_cost += IOMMU_PAGE_TABLE_WRITE_COST;
+        charge_cycles(COST_IOMMU, IOMMU_PAGE_TABLE_WRITE_COST);
+    }
+
+    return io_page_number;
+}
+
+
+/**
+ * @brief Unmap an I/O buffer of a device and free its frames. In strict mode, the IOTLB entries of the buffer are invalidated at once, and the I/O virtual pages are free again. In lazy mode, the invalidation is queued and the I/O virtual pages stay reserved until the queue is flushed, so the device could still reach the freed frames through a stale IOTLB entry until then.
+ * 
+ * @param device_id The device the buffer was mapped for.
+ * @param io_page_number The first I/O virtual page of the buffer.
+ * @param no_of_pages The size of the buffer in pages.
+ */
+void dma_unmap(int device_id, int io_page_number, int no_of_pages) {
+    for (int i = 0; i < no_of_pages; i++) {
+        struct page_table_entry *io_pte = get_io_page_table_entry(device_id, io_page_number + i);
+        release_frame(io_pte->frame_number);
+        io_pte->frame_number = -1;
+        io_pte->valid = 0;
+        iommu_unmap_cost += IOMMU_PAGE_TABLE_WRITE_COST;
+        charge_cycles(COST_IOMMU, IOMMU_PAGE_TABLE_WRITE_COST);
+    }
+
+    if (IOMMU_UNMAP_MODE == IOMMU_UNMAP_STRICT) {
+        tlb_invalidate(&iotlb, device_id, io_page_number, no_of_pages);
+        no_of_iotlb_invalidations++;
+        iommu_unmap_cost += IOTLB_INVALIDATION_COST;
+        charge_cycles(COST_IOMMU, IOTLB_INVALIDATION_COST);
+        return;
+    }
+
+    for (int i = 0; i < no_of_pages; i++) {
+        dma_devices[device_id].is_io_page_pending[io_page_number + i] = 1;
+    }
+
+    struct invalidation_request request = {device_id, io_page_number, no_of_pages};
+    invalidation_queue[invalidation_queue_length] = request;
+    invalidation_queue_length++;
+
+    if (invalidation_queue_length == INVALIDATION_QUEUE_SIZE) {
+        flush_invalidation_queue();
+    }
+}
+
+
+/**
+ * @brief Translate an I/O virtual address of a device the way the IOMMU would. The IOTLB is searched first. On a miss, the device's two-level I/O page table is walked and the translation is inserted into the IOTLB.
+ * 
+ * @param device_id The device making the access.
+ * @param io_virtual_address The I/O virtual address.
+ * @return The physical address. It's -1 if the I/O virtual page isn't mapped (an IOMMU fault).
+ */
+int iommu_translate(int device_id, int io_virtual_address) {
+    int io_page_number = io_virtual_address / PAGE_SIZE;
+    int offset = io_virtual_address % PAGE_SIZE;
+
+    no_of_dma_accesses++;
+
+    struct tlb_entry *entry = tlb_lookup(&iotlb, device_id, io_page_number);
+    if (entry != NULL) {
+        iotlb.hits++;
+        return entry->frame_number * FRAME_SIZE + offset;
+    }
+
+    iotlb.misses++;
+    no_of_io_page_walk_references += 2; // outer I/O page table entry, then inner I/O page table entry
+    charge_cycles(COST_IOMMU, 2 * PAGE_WALK_REFERENCE_COST);
+
+    struct page_table_entry *io_pte = get_io_page_table_entry(device_id, io_page_number);
+    if (io_pte->valid == 0) {
+        printf("IOMMU fault: device %d accessed unmapped I/O virtual page %d\n", device_id, io_page_number);
+        return -1;
+    }
+
+    struct tlb_entry translation = {1, device_id, io_page_number, io_pte->frame_number, 1, 0};
+    tlb_insert(&iotlb, translation);
+    return io_pte->frame_number * FRAME_SIZE + offset;
+}
+
+
+/**
+ * @brief Do every queued IOTLB invalidation with a single invalidation of the whole IOTLB, and free the I/O virtual pages waiting for it.
+ */
+void flush_invalidation_queue() {
+    if (invalidation_queue_length == 0) {
+        return;
+    }
+
+    for (int i = 0; i < TLB_SIZE; i++) {
+        iotlb.entries[i].valid = 0;
+    }
+    no_of_iotlb_invalidations++;
+    iommu_unmap_cost += IOTLB_INVALIDATION_COST;
+    charge_cycles(COST_IOMMU, IOTLB_INVALIDATION_COST);
+
+    for (int i = 0; i < invalidation_queue_length; i++) {
+        struct invalidation_request *request = &invalidation_queue[i];
+        for (int j = 0; j < request->no_of_pages; j++) {
+            dma_devices[request->device_id].is_io_page_pending[request->io_page_number + j] = 0;
+        }
+    }
+    invalidation_queue_length = 0;
+}
+
+
+/**
+ * @brief Do an I/O for a process through a random device. A buffer of random size is mapped, the device reads or writes every page of it, and the buffer is unmapped again.
+ * 
+ * @param process The process the I/O is for.
+ */
+void run_dma_io(struct PCB *process) {
+    int device_id = rand() % NO_OF_DMA_DEVICES;
+    int no_of_pages = rand() % DMA_MAX_IO_PAGES + 1;
+
+    int io_page_number = dma_map(device_id, process, no_of_pages);
+    if (io_page_number == -1) {
+        no_of_failed_dma_ios++;
+        return;
+    }
+    no_of_dma_ios++;
+
+    for (int i = 0; i < no_of_pages * DMA_ACCESSES_PER_PAGE; i++) {
+        iommu_translate(device_id, io_page_number * PAGE_SIZE + rand() % (no_of_pages * PAGE_SIZE));
+    }
+
+    dma_unmap(device_id, io_page_number, no_of_pages);
+}
+
+
+// --- COPY-ON-WRITE FORK ---
+
+
+/**
+ * @brief Fork a process. The child gets a copy of the parent's page tables, but no frames of its own: every mapped page of the child maps on to the parent's frame, whose reference count goes up, and the page is write-protected in both processes. Frames are only copied when either process writes to a shared page. Only populated inner page tables are copied, so the cost of a fork grows with the size of the page tables, not with the memory in use. Shared memory segments aren't copy-on-write: the child attaches them at the same addresses. Swapped out pages share their swap slot. The parent's TLB entries are shot down, since its pages are no longer writable.
+ * 
+ * @param parent The process to be forked.
+ * @param process_number The index of the child in the processes array. This is also the child's ID.
+ * @return A pointer to the child.
+ */
+struct PCB *fork_process(struct PCB *parent, int process_number) {
+    struct PCB *child = malloc(sizeof(struct PCB));
+    if (child == NULL) {
+        fprintf(stderr, "Failed to allocate memory for struct PCB\n");
+        exit(EXIT_FAILURE);
+    }
+
+    child->id = process_number;
+    child->size = parent->size;
+    child->size_in_memory = parent->size_in_memory;
+    child->start_page_number = parent->start_page_number;
+    child->is_guest = parent->is_guest;
+    processes[process_number] = child;
+    initialize_process_page_tables(child);
+
+    // The child's memory is charged up front, since every shared page may end up copied
+    available_physical_memory -= child->size_in_memory;
+    workload_positions[child->id] = workload_positions[parent->id];
+
+    int no_of_shared_frames = 0;
+    int no_of_page_table_references_before = no_of_fork_page_table_references;
+    for (int i = 0; i < OUTER_PAGE_TABLE_SIZE; i++) {
+        no_of_fork_page_table_references++; // outer page table entry
+
+        bool is_populated = false;
+        for (int j = 0; j < NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; j++) {
+            if (parent->inner_page_tables[i][j].valid == 1 || parent->inner_page_tables[i][j].swap_slot != -1) {
+                is_populated = true;
+            }
+        }
+        if (!is_populated) {
+            continue;
+        }
+
+        for (int j = 0; j < NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; j++) {
+            int page_number = i * NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE + j;
+            struct page_table_entry *pte = &parent->inner_page_tables[i][j];
+
+            no_of_fork_page_table_references += 2; // the parent's entry is read and the child's is written
+            if (pte->swap_slot != -1) {
+                // Both processes hold the swap slot until they swap the page in
+                child->inner_page_tables[i][j].swap_slot = pte->swap_slot;
+                swap_map[pte->swap_slot]++;
+                continue;
+            }
+            if (pte->valid == 0 || get_shared_memory_segment(parent, page_number) != -1) {
+                continue;
+            }
+
+            share_frame(pte->frame_number);
+            set_page_table_entry(child, page_number, pte->frame_number);
+            write_protect_page(parent, page_number);
+            write_protect_page(child, page_number);
+            no_of_shared_frames++;
+        }
+
+        if (parent->huge_pages[i] == 1) {
+            map_huge_page(child, i);
+        }
+    }
+
+    // Shared memory stays shared, attached at the same address
+    for (int i = 0; i < NO_OF_SHARED_MEMORY_SEGMENTS; i++) {
+        if (shared_memory_attachments[parent->id][i] != -1) {
+            attach_shared_memory_segment(child, i, shared_memory_attachments[parent->id][i]);
+        }
+    }
+
+    charge_cycles(COST_FORK, (long)(no_of_fork_page_table_references - no_of_page_table_references_before) * PAGE_WALK_REFERENCE_COST);
+    tlb_shootdown(parent->id, 0, NO_OF_PAGES);
+
+    no_of_forks++;
+    no_of_frames_shared_by_fork += no_of_shared_frames;
+    printf("Process %d forked process %d, which shares %d frames with it copy-on-write.\n", parent->id, child->id, no_of_shared_frames);
+
+    return child;
+}
+
+
+/**
+ * @brief Take away the write permission of a page, so that the next write to it causes a copy-on-write fault. For a guest process, this is a write to its page table, so the shadow page table is synchronized.
+ * 
+ * @param process The process whose page is to be write-protected.
+ * @param page_number The page to be write-protected.
+ */
+void write_protect_page(struct PCB *process, int page_number) {
+    get_page_table_entry(process, page_number)->writable = 0;
+    if (process->is_guest) {
+        trap_guest_page_table_write(process, page_number);
+    }
+}
+
+
+/**
+ * @brief Handle a write to a page shared copy-on-write. If the page is part of a huge page, the huge page is split first, so that only the written page is copied. If the process is the last one using the frame (and it isn't a merged frame), the page is simply made writable again. Otherwise, the frame is copied into a free frame, which the page now maps on to, and the shared frame loses a reference. A page mapped on to the zero frame gets a free frame that is filled with zeros rather than copied (a zero-fill fault). A write to a merged page always copies it (it's unmerged), and is counted apart from copies of frames shared by forks.
+ * 
+ * @param process The process that wrote to the page.
+ * @param page_number The page that was written.
+ * @return The frame the page maps on to after the fault. It returns -1 if no frame was free for the copy.
+ */
+int handle_copy_on_write_fault(struct PCB *process, int page_number) {
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    if (process->huge_pages[inner_page_table_no] == 1) {
+        split_huge_page(process, inner_page_table_no);
+    }
+
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+    int shared_frame_number = pte->frame_number;
+    bool is_zero_fill = shared_frame_number == zero_frame_number;
+    bool is_unmerge = is_ksm_frame[shared_frame_number] == 1;
+
+    if (is_zero_fill) {
+        no_of_zero_fill_faults++;
+    }
+    else if (is_unmerge) {
+        no_of_ksm_unmerges++;
+    }
+    else {
+        no_of_copy_on_write_faults++;
+    }
+    charge_cycles(COST_MINOR_FAULT, MINOR_FAULT_COST);
+
+    if (!is_zero_fill && frame_reference_counts[shared_frame_number] == 1 && is_ksm_frame[shared_frame_number] == 0) {
+        no_of_copy_on_write_reuses++;
+        pte->writable = 1;
+        if (process->is_guest) {
+            trap_guest_page_table_write(process, page_number);
+        }
+        return shared_frame_number;
+    }
+
+    int frame_number = allocate_frame(process);
+    if (frame_number == -1) {
+        printf("No free frame was found to copy page %d of process %d on write\n", page_number, process->id);
+        return -1;
+    }
+
+    if (!is_zero_fill) {
+        copy_frame(frame_number, shared_frame_number);
+    }
+    if (!is_zero_fill && !is_unmerge) {
+        no_of_copy_on_write_copies++;
+    }
+    release_frame(shared_frame_number);
+    set_page_table_entry(process, page_number, frame_number);
+
+    tlb_shootdown(process->id, page_number, 1);
+
+    return frame_number;
+}
+
+
+// --- SHARED MEMORY ---
+
+
+/**
+ * @brief Open a shared memory segment by name. If no segment has the name, a segment is created, and a free frame is claimed for each of its pages on behalf of the opening process. The segment itself holds a reference to its frames until it's destroyed.
+ * 
+ * @param name The name of the segment.
+ * @param process The process opening the segment.
+ * @return The id of the segment. It's -1 if the segment didn't exist and couldn't be created.
+ */
+int open_shared_memory_segment(const char *name, struct PCB *process) {
+    int free_segment_id = -1;
+
+    for (int i = 0; i < NO_OF_SHARED_MEMORY_SEGMENTS; i++) {
+        if (shared_memory_segments[i].name[0] == '\0') {
+            if (free_segment_id == -1) {
+                free_segment_id = i;
+            }
+        }
+        else if (strcmp(shared_memory_segments[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    if (free_segment_id == -1) {
+        return -1;
+    }
+
+    struct shared_memory_segment *segment = &shared_memory_segments[free_segment_id];
+    for (int i = 0; i < SHARED_MEMORY_SEGMENT_PAGES; i++) {
+        segment->frame_numbers[i] = find_free_frame_block(1, 1);
+
+        if (segment->frame_numbers[i] == -1) {
+            printf("Not enough free frames to create shared memory segment %s\n", name);
+            for (int j = 0; j < i; j++) {
+                release_frame(segment->frame_numbers[j]);
+            }
+            return -1;
+        }
+        claim_frame(segment->frame_numbers[i], process);
+    }
+
+    snprintf(segment->name, SHARED_MEMORY_NAME_LENGTH, "%s", name);
+    segment->no_of_attachments = 0;
+    segment->has_inner_page_tables = 0;
+    no_of_shared_memory_segments_created++;
+
+    printf("Process %d created shared memory segment %s of %d pages.\n", process->id, name, SHARED_MEMORY_SEGMENT_PAGES);
+    return free_segment_id;
+}
+
+
+/**
+ * @brief Attach a shared memory segment to a process, at the given pages or at the first free pages of its address space outside the pages it occupies. Every attachment adds a reference to the segment's frames. A process that isn't a guest attaches at an address aligned to an inner page table (if SHARE_INNER_PAGE_TABLES is on), so its outer page table entries can point to the segment's inner page tables: their entries are only written by the first such attachment, and the next ones cost one outer page table entry per inner page table instead of one entry per page. Guests always get their own entries, since their entries hold guest-physical frame numbers. The inverted and cuckoo page tables have no inner page tables to share, so a shared attachment still adds the segment's pages to them.
+ * 
+ * @param process The process attaching the segment.
+ * @param segment_id The segment to be attached.
+ * @param page_number The first page to attach the segment at, or -1 to attach it at the first free pages. The pages must be unmapped.
+ * @return The first page the segment is attached at. It's -1 if the process has no free pages for it. A segment left with no attachments is destroyed.
+ */
+int attach_shared_memory_segment(struct PCB *process, int segment_id, int page_number) {
+    struct shared_memory_segment *segment = &shared_memory_segments[segment_id];
+    bool is_shared = SHARE_INNER_PAGE_TABLES && !process->is_guest;
+
+    if (page_number == -1) {
+        page_number = find_free_virtual_pages(process, SHARED_MEMORY_SEGMENT_PAGES, is_shared ? NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE : 1);
+    }
+    for (int i = 0; i < SHARED_MEMORY_SEGMENT_PAGES && page_number != -1; i++) {
+        if (get_page_table_entry(process, page_number + i)->valid == 1 || get_page_table_entry(process, page_number + i)->swap_slot != -1) {
+            page_number = -1;
+        }
+    }
+    if (page_number == -1) {
+        printf("Process %d has no free pages to attach shared memory segment %s\n", process->id, segment->name);
+        if (segment->no_of_attachments == 0) {
+            destroy_shared_memory_segment(segment_id);
+        }
+        return -1;
+    }
+
+    if (is_shared && segment->has_inner_page_tables == 0) {
+        for (int i = 0; i < SHARED_MEMORY_SEGMENT_PAGES; i++) {
+            struct page_table_entry *pte = &segment->inner_page_tables[i / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE][i % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+            pte->frame_number = segment->frame_numbers[i];
+            pte->valid = 1;
+            pte->guest_frame_number = -1;
+            pte->writable = 1;
+            pte->swap_slot = -1;
+            pte->accessed = 0;
+            pte->dirty = 0;
+        }
+        segment->has_inner_page_tables = 1;
+        no_of_shared_memory_page_table_writes += SHARED_MEMORY_SEGMENT_PAGES;
+    }
+    else if (is_shared) {
+        no_of_shared_memory_page_table_writes_saved += SHARED_MEMORY_SEGMENT_PAGES - SHARED_MEMORY_INNER_PAGE_TABLES;
+    }
+
+    for (int i = 0; i < SHARED_MEMORY_SEGMENT_PAGES; i++) {
+        int frame_number = segment->frame_numbers[i];
+        share_frame(frame_number);
+
+        if (!is_shared) {
+            set_page_table_entry(process, page_number + i, frame_number);
+            no_of_shared_memory_page_table_writes++;
+            continue;
+        }
+
+        // The per-process structures set_page_table_entry would otherwise keep up to date
+        int inner_page_table_no = (page_number + i) / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+        shared_inner_page_tables[process->id][inner_page_table_no] = segment->inner_page_tables[i / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE];
+        inverted_page_table_insert(frame_number, process->id, page_number + i);
+        cuckoo_page_table_insert(&cuckoo_page_tables[process->id][SMALL_PAGE_SIZE_INDEX], page_number + i, frame_number);
+        cuckoo_walk_cache_invalidate(process->id, inner_page_table_no);
+    }
+
+    if (is_shared) {
+        no_of_shared_memory_page_table_writes += SHARED_MEMORY_INNER_PAGE_TABLES; // outer page table entries
+        no_of_shared_page_table_attachments++;
+        range_tables[process->id].is_stale = 1;
+    }
+
+    shared_memory_attachments[process->id][segment_id] = page_number;
+    segment->no_of_attachments++;
+    no_of_shared_memory_attachments++;
+
+    printf("Process %d attached shared memory segment %s at pages %d-%d%s.\n", process->id, segment->name, page_number, page_number + SHARED_MEMORY_SEGMENT_PAGES - 1,
+    is_shared ? " (shared inner page tables)" : "");
+    return page_number;
+}
+
+
+/**
+ * @brief Detach a shared memory segment from a process and drop the process' references to its frames. When the last process detaches the segment, the segment is destroyed and its frames are freed.
+ * 
+ * @param process The process detaching the segment.
+ * @param segment_id The segment to be detached.
+ */
+void detach_shared_memory_segment(struct PCB *process, int segment_id) {
+    struct shared_memory_segment *segment = &shared_memory_segments[segment_id];
+    int page_number = shared_memory_attachments[process->id][segment_id];
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+
+    if (shared_inner_page_tables[process->id][inner_page_table_no] != NULL) {
+        for (int i = 0; i < SHARED_MEMORY_SEGMENT_PAGES; i++) {
+            int frame_number = segment->frame_numbers[i];
+            if (inverted_page_table[frame_number].process_id == process->id && inverted_page_table[frame_number].page_number == page_number + i) {
+                inverted_page_table_remove(frame_number);
+            }
+            cuckoo_page_table_remove(&cuckoo_page_tables[process->id][SMALL_PAGE_SIZE_INDEX], page_number + i);
+            range_tlb_invalidate(process->id, page_number + i);
+            cuckoo_walk_cache_invalidate(process->id, (page_number + i) / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE);
+            shared_inner_page_tables[process->id][(page_number + i) / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE] = NULL;
+            release_frame(frame_number);
+        }
+        range_tables[process->id].is_stale = 1;
+    }
+    else {
+        for (int i = 0; i < SHARED_MEMORY_SEGMENT_PAGES; i++) {
+            set_page_table_entry(process, page_number + i, -1);
+            release_frame(segment->frame_numbers[i]);
+        }
+    }
+
+    tlb_shootdown(process->id, page_number, SHARED_MEMORY_SEGMENT_PAGES);
+    shared_memory_attachments[process->id][segment_id] = -1;
+    segment->no_of_attachments--;
+
+    if (segment->no_of_attachments == 0) {
+        destroy_shared_memory_segment(segment_id);
+    }
+}
+
+
+/**
+ * @brief Destroy a shared memory segment no process is attached to, dropping the segment's own references to its frames, which frees them.
+ * 
+ * @param segment_id The segment to be destroyed.
+ */
+void destroy_shared_memory_segment(int segment_id) {
+    struct shared_memory_segment *segment = &shared_memory_segments[segment_id];
+    for (int i = 0; i < SHARED_MEMORY_SEGMENT_PAGES; i++) {
+        release_frame(segment->frame_numbers[i]);
+    }
+    printf("Shared memory segment %s destroyed.\n", segment->name);
+    segment->name[0] = '\0';
+    segment->has_inner_page_tables = 0;
+}
+
+
+/**
+ * @brief Find the first run of unmapped pages of a process (that aren't swapped out either), outside the pages it occupies, whose first page is a multiple of the alignment.
+ * 
+ * @param process The process whose address space is searched.
+ * @param no_of_pages The number of pages in the run.
+ * @param alignment The alignment of the run in pages.
+ * @return The first page of the run. It returns -1 if there is no such run.
+ */
+int find_free_virtual_pages(struct PCB *process, int no_of_pages, int alignment) {
+    int region_start = process->start_page_number;
+    int region_end = region_start + get_process_page_count(process);
+
+    for (int i = 0; i + no_of_pages <= NO_OF_PAGES; i += alignment) {
+        int page_counter = 0;
+        while (page_counter < no_of_pages && get_page_table_entry(process, i + page_counter)->valid == 0 && get_page_table_entry(process, i + page_counter)->swap_slot == -1
+        && (region_start == -1 || i + page_counter < region_start || i + page_counter >= region_end)) {
+            page_counter++;
+        }
+
+        if (page_counter == no_of_pages) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Find the shared memory segment a page of a process belongs to.
+ * 
+ * @param process The process the page belongs to.
+ * @param page_number The page.
+ * @return The id of the segment. It's -1 if the page isn't in an attached segment.
+ */
+int get_shared_memory_segment(struct PCB *process, int page_number) {
+    for (int i = 0; i < NO_OF_SHARED_MEMORY_SEGMENTS; i++) {
+        int first_page = shared_memory_attachments[process->id][i];
+        if (first_page != -1 && page_number >= first_page && page_number < first_page + SHARED_MEMORY_SEGMENT_PAGES) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Generate a logical address within a random shared memory segment attached to a process.
+ * 
+ * @param process The process making the access.
+ * @return The logical address to be accessed. It's -1 if the process has no shared memory attached.
+ */
+int generate_shared_memory_logical_address(struct PCB *process) {
+    int segment_ids[NO_OF_SHARED_MEMORY_SEGMENTS];
+    int no_of_segments = 0;
+
+    for (int i = 0; i < NO_OF_SHARED_MEMORY_SEGMENTS; i++) {
+        if (shared_memory_attachments[process->id][i] != -1) {
+            segment_ids[no_of_segments] = i;
+            no_of_segments++;
+        }
+    }
+
+    if (no_of_segments == 0) {
+        return -1;
+    }
+
+    int first_page = shared_memory_attachments[process->id][segment_ids[rand() % no_of_segments]];
+    return first_page * PAGE_SIZE + rand() % (SHARED_MEMORY_SEGMENT_PAGES * PAGE_SIZE);
+}
+
+
+// --- ZERO-FILL-ON-DEMAND ---
+
+
+/**
+ * @brief Count the frames in use and the pages of every process in memory that are still mapped on to the zero frame. A page mapped on to the zero frame takes up no memory of its own.
+ */
+void measure_resident_memory() {
+    no_of_zero_frame_mappings = 0;
+    no_of_resident_frames = 0;
+
+    for (int i = 0; i < NO_OF_FRAMES; i++) {
+        if (i != zero_frame_number && !is_frame_free(i)) {
+            no_of_resident_frames++;
+        }
+    }
+
+    if (zero_frame_number != -1) {
+        no_of_zero_frame_mappings = frame_reference_counts[zero_frame_number] - 1; // the zero frame's own reference
+    }
+}
+
+
+// --- SAME-PAGE MERGING ---
+
+
+/**
+ * @brief Wake up the same-page merging scanner. It scans the next KSM_PAGES_TO_SCAN mapped pages, continuing from where the last scan stopped and moving on to the next process when a process' pages have all been scanned. When the scanner has been through every process, the unstable tree is emptied and the stable tree is rebuilt without the merged frames that have since been freed.
+ */
+void run_ksm_scanner() {
+    int no_of_pages_scanned = 0;
+
+    for (int i = 0; i < MAX_PROCESS_COUNT * NO_OF_PAGES && no_of_pages_scanned < KSM_PAGES_TO_SCAN; i++) {
+        int process_number = ksm_cursor / NO_OF_PAGES;
+        int page_number = ksm_cursor % NO_OF_PAGES;
+
+        ksm_cursor = (ksm_cursor + 1) % (MAX_PROCESS_COUNT * NO_OF_PAGES);
+        if (ksm_cursor == 0) {
+            no_of_ksm_full_scans++;
+            unstable_tree_root = -1;
+            unstable_tree_size = 0;
+            rebuild_stable_tree();
+        }
+
+        if (processes[process_number] != NULL && is_process_exited[process_number] == 0 && ksm_scan_page(processes[process_number], page_number)) {
+            no_of_pages_scanned++;
+        }
+    }
+}
+
+
+/**
+ * @brief Scan a page for same-page merging. Only private small pages are scanned: not pages mapped on to the zero frame, frames any process maps as part of a huge page, shared memory, or frames with references from outside the page tables. The page's contents are first looked up in the stable tree of merged frames, and on a match, the page is merged into the merged frame. Otherwise, the page is only a candidate if its checksum is the same as at the last scan, since pages that keep changing aren't worth merging. A candidate is looked up in the unstable tree. On a match, the two frames are merged: the frame in the unstable tree becomes a merged frame, which moves to the stable tree, and the page is merged into it. Without a match, the page is added to the unstable tree.
+ * 
+ * @param process The process whose page is to be scanned.
+ * @param page_number The page to be scanned.
+ * @return true if the page was scanned and false if it isn't a page the scanner merges.
+ */
+bool ksm_scan_page(struct PCB *process, int page_number) {
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+    if (pte->valid == 0) {
+        return false;
+    }
+
+    int frame_number = pte->frame_number;
+    if (frame_number == zero_frame_number || is_ksm_frame[frame_number] == 1 || is_frame_mapped_by_huge_page(frame_number)
+    || get_shared_memory_segment(process, page_number) != -1 || frame_reference_counts[frame_number] != get_reverse_map_count(frame_number)) {
+        return false;
+    }
+
+    no_of_ksm_pages_scanned++;
+
+    int *link;
+    int node = ksm_tree_search(stable_tree, &stable_tree_root, frame_number, &link);
+    if (node != -1 && is_ksm_frame[stable_tree[node].frame_number] == 1) {
+        ksm_merge_frame(frame_number, stable_tree[node].frame_number);
+        return true;
+    }
+
+    unsigned int checksum = checksum_frame(frame_number);
+    if (checksum != page_checksums[process->id][page_number]) {
+        page_checksums[process->id][page_number] = checksum;
+        return true;
+    }
+
+    node = ksm_tree_search(unstable_tree, &unstable_tree_root, frame_number, &link);
+    if (node == -1) {
+        ksm_tree_insert(unstable_tree, &unstable_tree_size, link, frame_number, process->id, page_number);
+        return true;
+    }
+
+    // The page in the unstable tree may have been written or unmapped since it was added
+    struct ksm_tree_node *match = &unstable_tree[node];
+    int ksm_frame_number = match->frame_number;
+    struct page_table_entry *match_pte = get_page_table_entry(processes[match->process_id], match->page_number);
+    if (ksm_frame_number == frame_number || match_pte->valid == 0 || match_pte->frame_number != ksm_frame_number || is_ksm_frame[ksm_frame_number] == 1
+    || is_frame_mapped_by_huge_page(ksm_frame_number) || frame_reference_counts[ksm_frame_number] != get_reverse_map_count(ksm_frame_number) || memcmp(frame_contents[frame_number], frame_contents[ksm_frame_number], FRAME_SIZE) != 0) {
+        return true;
+    }
+
+    for (int mapping = reverse_map_heads[ksm_frame_number]; mapping != -1; mapping = reverse_map_next[mapping]) {
+        write_protect_page(processes[mapping / NO_OF_PAGES], mapping % NO_OF_PAGES);
+        tlb_shootdown(mapping / NO_OF_PAGES, mapping % NO_OF_PAGES, 1);
+    }
+    is_ksm_frame[ksm_frame_number] = 1;
+
+    if (ksm_tree_search(stable_tree, &stable_tree_root, ksm_frame_number, &link) == -1) {
+        ksm_tree_insert(stable_tree, &stable_tree_size, link, ksm_frame_number, -1, -1);
+    }
+    ksm_merge_frame(frame_number, ksm_frame_number);
+    return true;
+}
+
+
+/**
+ * @brief Search a same-page merging tree for a frame with the same contents as a frame. Each node visited costs a comparison of two frames.
+ * 
+ * @param tree The nodes of the tree.
+ * @param root The index of the root node, -1 if the tree is empty.
+ * @param frame_number The frame whose contents are searched for.
+ * @param link If no node matches, set to the link the frame's node would be inserted at.
+ * @return The index of the node with the same contents. It's -1 if there is none.
+ */
+int ksm_tree_search(struct ksm_tree_node *tree, int *root, int frame_number, int **link) {
+    int *node_link = root;
+
+    while (*node_link != -1) {
+        struct ksm_tree_node *node = &tree[*node_link];
+        ksm_bytes_compared += FRAME_SIZE;
+        charge_cycles(COST_KSM, FRAME_SIZE * KSM_COMPARE_COST_PER_BYTE);
+
+        int comparison = memcmp(frame_contents[frame_number], frame_contents[node->frame_number], FRAME_SIZE);
+        if (comparison == 0) {
+            return *node_link;
+        }
+        node_link = comparison < 0 ? &node->left : &node->right;
+    }
+
+    *link = node_link;
+    return -1;
+}
+
+
+/**
+ * @brief Add a node to a same-page merging tree, at the link a search for its frame ended at. Nothing is added if the tree is full, which only happens when frames are freed and reused within a scan.
+ * 
+ * @param tree The nodes of the tree.
+ * @param size The number of nodes in the tree.
+ * @param link The link the node is inserted at.
+ * @param frame_number The frame the node stands for.
+ * @param process_id The process the scanned page belongs to, -1 in the stable tree.
+ * @param page_number The scanned page, -1 in the stable tree.
+ */
+void ksm_tree_insert(struct ksm_tree_node *tree, int *size, int *link, int frame_number, int process_id, int page_number) {
+    if (*size == NO_OF_FRAMES) {
+        return;
+    }
+
+    struct ksm_tree_node node = {frame_number, process_id, page_number, -1, -1};
+    tree[*size] = node;
+    *link = *size;
+    (*size)++;
+}
+
+
+/**
+ * @brief Check whether any of the pages mapping on to a frame is part of a huge page. Such a frame can't be merged, since remapping one page of a huge page would break its block of consecutive frames.
+ * 
+ * @param frame_number The frame to be checked.
+ * @return true if a huge page maps on to the frame and false if otherwise.
+ */
+bool is_frame_mapped_by_huge_page(int frame_number) {
+    for (int mapping = reverse_map_heads[frame_number]; mapping != -1; mapping = reverse_map_next[mapping]) {
+        if (processes[mapping / NO_OF_PAGES]->huge_pages[(mapping % NO_OF_PAGES) / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE] == 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Merge a frame into a merged frame with the same contents. The reverse map gives every page mapping on to the frame. Each of them is remapped read-only on to the merged frame, and the frame loses its reference, so it's freed once the last page is remapped.
+ * 
+ * @param frame_number The frame to be merged.
+ * @param ksm_frame_number The merged frame.
+ */
+void ksm_merge_frame(int frame_number, int ksm_frame_number) {
+    while (reverse_map_heads[frame_number] != -1) {
+        int mapping = reverse_map_heads[frame_number];
+        struct PCB *process = processes[mapping / NO_OF_PAGES];
+        int page_number = mapping % NO_OF_PAGES;
+
+        share_frame(ksm_frame_number);
+        set_page_table_entry(process, page_number, ksm_frame_number);
+        write_protect_page(process, page_number);
+        release_frame(frame_number);
+
+        tlb_shootdown(process->id, page_number, 1);
+        no_of_ksm_merges++;
+    }
+
+    if (is_frame_free(frame_number)) {
+        no_of_ksm_frames_freed++;
+    }
+}
+
+
+/**
+ * @brief Rebuild the stable tree from the merged frames that are still in use.
+ */
+void rebuild_stable_tree() {
+    stable_tree_root = -1;
+    stable_tree_size = 0;
+
+    for (int i = 0; i < NO_OF_FRAMES; i++) {
+        int *link;
+        if (is_ksm_frame[i] == 1 && ksm_tree_search(stable_tree, &stable_tree_root, i, &link) == -1) {
+            ksm_tree_insert(stable_tree, &stable_tree_size, link, i, -1, -1);
+        }
+    }
+}
+
+
+/**
+ * @brief Checksum the contents of a frame (FNV-1a).
+ * 
+ * @param frame_number The frame to be checksummed.
+ * @return The checksum.
+ */
+unsigned int checksum_frame(int frame_number) {
+    unsigned int checksum = 2166136261u;
+
+    for (int j = 0; j < FRAME_SIZE; j++) {
+        checksum = (checksum ^ frame_contents[frame_number][j]) * 16777619u;
+    }
+    ksm_bytes_hashed += FRAME_SIZE;
+    charge_cycles(COST_KSM, FRAME_SIZE * KSM_HASH_COST_PER_BYTE);
+    return checksum;
+}
+
+
+// --- SWAPPING ---
+
+
+/**
+ * @brief Set aside the frames of the compressed pool, and open the swap file. The pool's frames hold a reference of their own, so they're never freed or evicted.
+ */
+void initialize_swap() {
+    for (int i = 0; i < SWAP_FILE_SLOTS; i++) {
+        swap_map[i] = 0;
+        zswap_entries[i].is_stored = 0;
+    }
+
+    for (int i = 0; i < NO_OF_CPUS; i++) {
+        swap_clusters[i] = -1;
+        swap_cluster_offsets[i] = 0;
+    }
+
+    for (int i = 0; i < ZSWAP_POOL_FRAMES && ZSWAP_ENABLED; i++) {
+        int frame_number = find_free_frame_block(1, 1);
+        for (int j = 0; j < FRAME_SIZE; j++) {
+            physical_memory[frame_number][j].id = ZSWAP_POOL_OWNER_ID;
+        }
+        frame_reference_counts[frame_number] = 1;
+        available_physical_memory -= FRAME_SIZE;
+
+        zswap_pool[i].frame_number = frame_number;
+        zswap_pool[i].size_class = 0;
+        zswap_pool[i].no_of_used_objects = 0;
+        zswap_pool[i].used_objects = 0;
+    }
+
+    swap_file = tmpfile();
+    if (swap_file == NULL) {
+        printf("The swap file could not be opened. Pages won't be swapped out.\n");
+    }
+}
+
+
+/**
+ * @brief Give a process a frame of its own, of the color page coloring picks for it. If no frame is free, a page is evicted to free one, on the CPU making the access (or CPU id % NO_OF_CPUS outside accesses).
+ * 
+ * @param process The process the frame is for.
+ * @return The frame, claimed for the process. It returns -1 if no frame is free and no page can be evicted.
+ */
+int allocate_frame(struct PCB *process) {
+    int cpu = running_cpu != -1 ? running_cpu : process->id % NO_OF_CPUS;
+    int frame_number = allocate_free_frame(process);
+
+    while (frame_number == -1 && evict_page(cpu)) {
+        frame_number = allocate_free_frame(process);
+    }
+    return frame_number;
+}
+
+
+/**
+ * @brief Give a process a free frame of its own, of the color page coloring picks for it, without evicting a page.
+ * 
+ * @param process The process the frame is for.
+ * @return The frame, claimed for the process. It returns -1 if no frame is free.
+ */
+int allocate_free_frame(struct PCB *process) {
+    int frame_number = find_colored_free_frame(process);
+    if (frame_number == -1) {
+        return -1;
+    }
+
+    record_uncolored_frame(frame_number);
+    claim_frame(frame_number, process);
+    no_of_frames_given_per_color[get_frame_color(frame_number)]++;
+    return frame_number;
+}
+
+
+/**
+ * @brief Evict a page to free its frame. The frames are gone through like a clock, starting after the last frame evicted. A page whose accessed bit is set gets a second chance: the bit is cleared, and the page is only evicted if it hasn't been accessed again by the time the clock comes back round. Only a frame mapped by a single small private page is evicted: not the zero frame, the pool's frames, merged frames, frames pinned for I/O, huge pages or shared memory.
+ * 
+ * @param cpu The CPU the eviction runs on. Its swap slot comes from the CPU's cluster.
+ * @return true if a page was evicted and false if no page can be.
+ */
+bool evict_page(int cpu) {
+    for (int i = 0; i < 2 * NO_OF_FRAMES; i++) {
+        int frame_number = eviction_clock_hand;
+        eviction_clock_hand = (eviction_clock_hand + 1) % NO_OF_FRAMES;
+
+        if (frame_number == readahead_pinned_frame || frame_reference_counts[frame_number] != 1 || get_reverse_map_count(frame_number) != 1 || is_ksm_frame[frame_number] == 1) {
+            continue;
+        }
+
+        int mapping = reverse_map_heads[frame_number];
+        struct PCB *process = processes[mapping / NO_OF_PAGES];
+        int page_number = mapping % NO_OF_PAGES;
+        if (process->huge_pages[page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE] == 1 || get_shared_memory_segment(process, page_number) != -1) {
+            continue;
+        }
+
+        struct page_table_entry *pte = get_page_table_entry(process, page_number);
+        if (pte->accessed == 1) {
+            pte->accessed = 0;
+            continue;
+        }
+
+        if (swap_out_page(process, page_number, cpu)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Swap a page out to a swap slot and free its frame. The page is compressed into the pool if it can be, and written to the swap file otherwise.
+ * 
+ * @param process The process whose page is to be swapped out.
+ * @param page_number The page to be swapped out.
+ * @param cpu The CPU the eviction runs on.
+ * @return true if the page was swapped out and false if no swap slot is free.
+ */
+bool swap_out_page(struct PCB *process, int page_number, int cpu) {
+    int swap_slot = allocate_swap_slot(cpu);
+    if (swap_slot == -1) {
+        return false;
+    }
+
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+    int frame_number = pte->frame_number;
+    if (pte->dirty == 1) {
+        no_of_dirty_evictions++;
+    }
+
+    if (!ZSWAP_ENABLED || !zswap_store(swap_slot, frame_contents[frame_number])) {
+        write_swap_file(swap_slot, frame_contents[frame_number]);
+    }
+
+    release_frame(frame_number);
+    set_page_table_entry(process, page_number, -1);
+    pte->swap_slot = swap_slot;
+
+    tlb_shootdown(process->id, page_number, 1);
+    no_of_evictions++;
+
+    printf("Page %d of process %d was swapped out to slot %d.\n", page_number, process->id, swap_slot);
+    return true;
+}
+
+
+/**
+ * @brief Swap a page back in from its swap slot, which is freed once no other process holds it. The page is mapped writable, since a swapped in page has a frame of its own, even if it was shared copy-on-write before.
+ * 
+ * @param process The process whose page is to be swapped in.
+ * @param page_number The page to be swapped in.
+ * @return The frame the page was swapped into. It returns -1 if no frame could be found.
+ */
+int swap_in_page(struct PCB *process, int page_number) {
+    int frame_number = allocate_frame(process);
+    if (frame_number == -1) {
+        printf("No free frame was found to swap in page %d of process %d\n", page_number, process->id);
+        return -1;
+    }
+
+    load_swapped_page(process, page_number, frame_number);
+    no_of_swap_ins++;
+
+    return frame_number;
+}
+
+
+/**
+ * @brief Load a swapped out page into a frame claimed for it, from the pool or the swap file, and map it. Its swap slot is freed once no other process holds it.
+ * 
+ * @param process The process whose page is loaded.
+ * @param page_number The page to be loaded.
+ * @param frame_number The frame the page is loaded into.
+ */
+void load_swapped_page(struct PCB *process, int page_number, int frame_number) {
+    struct page_table_entry *pte = get_page_table_entry(process, page_number);
+    int swap_slot = pte->swap_slot;
+
+    if (!ZSWAP_ENABLED || !zswap_load(swap_slot, frame_contents[frame_number])) {
+        read_swap_file(swap_slot, frame_contents[frame_number]);
+    }
+
+    free_swap_slot(swap_slot);
+    pte->swap_slot = -1;
+    set_page_table_entry(process, page_number, frame_number);
+}
+
+
+/**
+ * @brief Find a free swap slot and give it a single reference. The slot is the next free one of the CPU's cluster, so the pages a CPU evicts one after another get consecutive slots and can be written together. When the cluster is used up, the CPU is given a new one, and when no whole cluster is free, the first free slot is used.
+ * 
+ * @param cpu The CPU allocating the slot.
+ * @return The swap slot. It returns -1 if the swap file is full or couldn't be opened.
+ */
+int allocate_swap_slot(int cpu) {
+    if (swap_file == NULL) {
+        return -1;
+    }
+
+    if (swap_clusters[cpu] != -1) {
+        for (int i = swap_cluster_offsets[cpu]; i < SWAP_CLUSTER_SIZE; i++) {
+            int swap_slot = swap_clusters[cpu] * SWAP_CLUSTER_SIZE + i;
+            if (swap_map[swap_slot] == 0) {
+                swap_map[swap_slot] = 1;
+                swap_cluster_offsets[cpu] = i + 1;
+                return swap_slot;
+            }
+        }
+    }
+
+    if (allocate_swap_cluster(cpu)) {
+        int swap_slot = swap_clusters[cpu] * SWAP_CLUSTER_SIZE;
+        swap_map[swap_slot] = 1;
+        swap_cluster_offsets[cpu] = 1;
+        return swap_slot;
+    }
+
+    for (int i = 0; i < SWAP_FILE_SLOTS; i++) {
+        if (swap_map[i] == 0) {
+            swap_map[i] = 1;
+            no_of_swap_slot_fallbacks++;
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Give a CPU a new cluster: one whose slots are all free and which no other CPU is allocating from.
+ * 
+ * @param cpu The CPU.
+ * @return true if a cluster was found and false otherwise, in which case the CPU is left without a cluster.
+ */
+bool allocate_swap_cluster(int cpu) {
+    swap_clusters[cpu] = -1;
+
+    for (int i = 0; i < NO_OF_SWAP_CLUSTERS; i++) {
+        bool is_free = true;
+        for (int j = 0; j < NO_OF_CPUS && is_free; j++) {
+            if (swap_clusters[j] == i) {
+                is_free = false;
+            }
+        }
+        for (int j = 0; j < SWAP_CLUSTER_SIZE && is_free; j++) {
+            if (swap_map[i * SWAP_CLUSTER_SIZE + j] != 0) {
+                is_free = false;
+            }
+        }
+
+        if (is_free) {
+            swap_clusters[cpu] = i;
+            no_of_swap_clusters_allocated++;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Drop a reference to a swap slot. When no reference is left, the slot is free and its page is dropped from the pool.
+ * 
+ * @param swap_slot The swap slot to be freed.
+ */
+void free_swap_slot(int swap_slot) {
+    swap_map[swap_slot]--;
+    if (swap_map[swap_slot] == 0) {
+        zswap_invalidate(swap_slot);
+
+        // A page still in the write batch doesn't need to be written any more
+        for (int i = 0; i < no_of_pending_swap_writes; i++) {
+            if (swap_write_batch[i].swap_slot == swap_slot) {
+                swap_write_batch[i] = swap_write_batch[--no_of_pending_swap_writes];
+                break;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Queue a page to be written to its slot of the swap file. The batch is written out when it's full.
+ * 
+ * @param swap_slot The swap slot.
+ * @param page The contents of the page.
+ */
+void write_swap_file(int swap_slot, unsigned char *page) {
+    for (int i = 0; i < no_of_pending_swap_writes; i++) {
+        if (swap_write_batch[i].swap_slot == swap_slot) {
+            memcpy(swap_write_batch[i].page, page, PAGE_SIZE);
+            return;
+        }
+    }
+
+    swap_write_batch[no_of_pending_swap_writes].swap_slot = swap_slot;
+    memcpy(swap_write_batch[no_of_pending_swap_writes].page, page, PAGE_SIZE);
+    no_of_pending_swap_writes++;
+
+    if (no_of_pending_swap_writes == SWAP_WRITE_BATCH_SIZE) {
+        flush_swap_writes();
+    }
+}
+
+
+/**
+ * @brief Write out the batch. The pages are sorted by swap slot, and each run of consecutive slots is written with a single vectored write.
+ */
+void flush_swap_writes() {
+    qsort(swap_write_batch, no_of_pending_swap_writes, sizeof(struct swap_write), compare_swap_writes);
+
+    int run_start = 0;
+    while (run_start < no_of_pending_swap_writes) {
+        struct iovec vectors[SWAP_WRITE_BATCH_SIZE];
+        int run_length = 0;
+        while (run_start + run_length < no_of_pending_swap_writes && swap_write_batch[run_start + run_length].swap_slot == swap_write_batch[run_start].swap_slot + run_length) {
+            vectors[run_length].iov_base = swap_write_batch[run_start + run_length].page;
+            vectors[run_length].iov_len = PAGE_SIZE;
+            run_length++;
+        }
+
+        int swap_slot = swap_write_batch[run_start].swap_slot;
+        if (pwritev(fileno(swap_file), vectors, run_length, (off_t)swap_slot * PAGE_SIZE) != run_length * PAGE_SIZE) {
+            printf("Swap slots %d to %d could not be written\n", swap_slot, swap_slot + run_length - 1);
+        }
+        no_of_swap_write_ios++;
+        no_of_swap_file_writes += run_length;
+        charge_cycles(COST_SWAP_WRITE, SWAP_FILE_WRITE_TIME);
+        run_start += run_length;
+    }
+
+    no_of_pending_swap_writes = 0;
+}
+
+
+/**
+ * @brief Compare two pages of the write batch by swap slot, for qsort.
+ * 
+ * @param a The first page.
+ * @param b The second page.
+ * @return A negative number, zero or a positive number as the first slot is lower than, the same as or higher than the second.
+ */
+int compare_swap_writes(const void *a, const void *b) {
+    return ((const struct swap_write *)a)->swap_slot - ((const struct swap_write *)b)->swap_slot;
+}
+
+
+/**
+ * @brief Read a page from its slot of the swap file. A page still in the write batch is copied from the batch instead.
+ * 
+ * @param swap_slot The swap slot.
+ * @param page Set to the contents of the page.
+ */
+void read_swap_file(int swap_slot, unsigned char *page) {
+    for (int i = 0; i < no_of_pending_swap_writes; i++) {
+        if (swap_write_batch[i].swap_slot == swap_slot) {
+            memcpy(page, swap_write_batch[i].page, PAGE_SIZE);
+            no_of_swap_batch_hits++;
+            return;
+        }
+    }
+
+    if (pread(fileno(swap_file), page, PAGE_SIZE, (off_t)swap_slot * PAGE_SIZE) != PAGE_SIZE) {
+        printf("Swap slot %d could not be read\n", swap_slot);
+    }
+    no_of_swap_file_reads++;
+    charge_cycles(COST_SWAP_IO, SWAP_FILE_READ_TIME);
+}
+
+
+/**
+ * @brief Check whether a swapped out page can be loaded without reading the swap file, because it's in the pool or still waiting in the write batch.
+ * 
+ * @param swap_slot The swap slot the page was swapped out to.
+ * @return true if the page is in memory and false if it has to be read from the swap file.
+ */
+bool is_swapped_page_in_memory(int swap_slot) {
+    if (ZSWAP_ENABLED && zswap_entries[swap_slot].is_stored == 1) {
+        return true;
+    }
+
+    for (int i = 0; i < no_of_pending_swap_writes; i++) {
+        if (swap_write_batch[i].swap_slot == swap_slot) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// --- COMPRESSED SWAP POOL ---
+
+
+/**
+ * @brief Compress a page into the pool. A page that doesn't compress to ZSWAP_MAX_COMPRESSED_SIZE or less is rejected, as storing it would save too little. If the pool has no room for the page, the oldest pages in the pool are written back to the swap file until it does.
+ * 
+ * @param swap_slot The swap slot the page is swapped out to.
+ * @param page The contents of the page.
+ * @return true if the page was stored in the pool and false if it has to be written to the swap file.
+ */
+bool zswap_store(int swap_slot, unsigned char *page) {
+    unsigned char compressed_page[2 * PAGE_SIZE];
+    int compressed_size = lz_compress(page, PAGE_SIZE, compressed_page);
+
+    if (compressed_size > ZSWAP_MAX_COMPRESSED_SIZE) {
+        no_of_zswap_rejections++;
+        return false;
+    }
+
+    int size_class = (compressed_size + ZSWAP_SIZE_CLASS_STEP - 1) / ZSWAP_SIZE_CLASS_STEP * ZSWAP_SIZE_CLASS_STEP;
+    if (size_class == 0) {
+        size_class = ZSWAP_SIZE_CLASS_STEP;
+    }
+
+    int pool_frame_index, object_index;
+    while (!zswap_allocate_object(size_class, &pool_frame_index, &object_index)) {
+        if (!zswap_write_back_oldest()) {
+            no_of_zswap_rejections++;
+            return false;
+        }
+    }
+
+    memcpy(&frame_contents[zswap_pool[pool_frame_index].frame_number][object_index * size_class], compressed_page, compressed_size);
+
+    struct zswap_entry *entry = &zswap_entries[swap_slot];
+    entry->is_stored = 1;
+    entry->pool_frame_index = pool_frame_index;
+    entry->object_index = object_index;
+    entry->compressed_size = compressed_size;
+    entry->stored_at = zswap_clock++;
+
+    no_of_zswap_stores++;
+    zswap_uncompressed_bytes += PAGE_SIZE;
+    zswap_compressed_bytes += compressed_size;
+    return true;
+}
+
+
+/**
+ * @brief Decompress a page from the pool, and drop it from the pool.
+ * 
+ * @param swap_slot The swap slot the page was swapped out to.
+ * @param page Set to the contents of the page.
+ * @return true if the page was in the pool and false if it has to be read from the swap file.
+ */
+bool zswap_load(int swap_slot, unsigned char *page) {
+    struct zswap_entry *entry = &zswap_entries[swap_slot];
+    if (entry->is_stored == 0) {
+        return false;
+    }
+
+    struct zswap_pool_frame *pool_frame = &zswap_pool[entry->pool_frame_index];
+    unsigned char *object = &frame_contents[pool_frame->frame_number][entry->object_index * pool_frame->size_class];
+    if (lz_decompress(object, entry->compressed_size, page, PAGE_SIZE) != PAGE_SIZE) {
+        printf("The page of swap slot %d could not be decompressed\n", swap_slot);
+    }
+
+    // A slot shared by forked processes may be swapped in again, so the page is kept in the swap file
+    if (swap_map[swap_slot] > 1) {
+        write_swap_file(swap_slot, page);
+    }
+    zswap_invalidate(swap_slot);
+    no_of_zswap_loads++;
+    return true;
+}
+
+
+/**
+ * @brief Drop the page of a swap slot from the pool, freeing its object. A pool frame whose objects are all free can be used for another size class.
+ * 
+ * @param swap_slot The swap slot.
+ */
+void zswap_invalidate(int swap_slot) {
+    struct zswap_entry *entry = &zswap_entries[swap_slot];
+    if (entry->is_stored == 0) {
+        return;
+    }
+
+    struct zswap_pool_frame *pool_frame = &zswap_pool[entry->pool_frame_index];
+    pool_frame->used_objects &= ~(1u << entry->object_index);
+    pool_frame->no_of_used_objects--;
+    if (pool_frame->no_of_used_objects == 0) {
+        pool_frame->size_class = 0;
+    }
+    entry->is_stored = 0;
+}
+
+
+/**
+ * @brief Write the page that has been in the pool longest back to the swap file, to make room in the pool.
+ * 
+ * @return true if a page was written back and false if the pool is empty.
+ */
+bool zswap_write_back_oldest() {
+    int oldest_swap_slot = -1;
+
+    for (int i = 0; i < SWAP_FILE_SLOTS; i++) {
+        if (zswap_entries[i].is_stored == 1 && (oldest_swap_slot == -1 || zswap_entries[i].stored_at < zswap_entries[oldest_swap_slot].stored_at)) {
+            oldest_swap_slot = i;
+        }
+    }
+    if (oldest_swap_slot == -1) {
+        return false;
+    }
+
+    unsigned char page[PAGE_SIZE];
+    struct zswap_entry *entry = &zswap_entries[oldest_swap_slot];
+    struct zswap_pool_frame *pool_frame = &zswap_pool[entry->pool_frame_index];
+    lz_decompress(&frame_contents[pool_frame->frame_number][entry->object_index * pool_frame->size_class], entry->compressed_size, page, PAGE_SIZE);
+
+    write_swap_file(oldest_swap_slot, page);
+    zswap_invalidate(oldest_swap_slot);
+    no_of_zswap_writebacks++;
+    return true;
+}
+
+
+/**
+ * @brief Find a free object of a size class in the pool. Each pool frame holds objects of a single size class, so a frame of the size class with a free object is used first, and an empty frame is given the size class otherwise.
+ * 
+ * @param size_class The size of the object in bytes.
+ * @param pool_frame_index Set to the pool frame the object is in.
+ * @param object_index Set to the object's index within the pool frame.
+ * @return true if an object was found and false if the pool has no room for it.
+ */
+bool zswap_allocate_object(int size_class, int *pool_frame_index, int *object_index) {
+    int empty_pool_frame_index = -1;
+
+    for (int i = 0; i < ZSWAP_POOL_FRAMES; i++) {
+        struct zswap_pool_frame *pool_frame = &zswap_pool[i];
+        if (pool_frame->size_class == 0 && empty_pool_frame_index == -1) {
+            empty_pool_frame_index = i;
+        }
+        if (pool_frame->size_class == size_class && pool_frame->no_of_used_objects < FRAME_SIZE / size_class) {
+            *pool_frame_index = i;
+            break;
+        }
+        if (i == ZSWAP_POOL_FRAMES - 1) {
+            if (empty_pool_frame_index == -1) {
+                return false;
+            }
+            *pool_frame_index = empty_pool_frame_index;
+            zswap_pool[empty_pool_frame_index].size_class = size_class;
+        }
+    }
+
+    struct zswap_pool_frame *pool_frame = &zswap_pool[*pool_frame_index];
+    for (int j = 0; j < FRAME_SIZE / size_class; j++) {
+        if ((pool_frame->used_objects & (1u << j)) == 0) {
+            pool_frame->used_objects |= 1u << j;
+            pool_frame->no_of_used_objects++;
+            *object_index = j;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Compress bytes with a small LZ77 codec. The output is a series of tokens. A token below 0x80 is followed by a run of (token + 1) literal bytes. A token of 0x80 or above is a match: bits 4-6 hold the length less LZ_MIN_MATCH, and bits 0-3 the offset back less one. A match may overlap the bytes it produces, so a run of a repeated byte is a single match. The longest match is taken at each byte (greedy parsing).
+ * 
+ * @param input The bytes to be compressed.
+ * @param input_size The number of bytes to be compressed.
+ * @param output Set to the compressed bytes. It must have room for input_size + input_size / LZ_MAX_LITERALS + 1 bytes.
+ * @return The size of the compressed bytes.
+ */
+int lz_compress(unsigned char *input, int input_size, unsigned char *output) {
+    int output_size = 0;
+    int literal_token = -1; // where the token of the current literal run is, -1 outside a literal run
+    int i = 0;
+
+    while (i < input_size) {
+        int best_length = 0, best_offset = 0;
+        for (int offset = 1; offset <= LZ_MAX_OFFSET && offset <= i; offset++) {
+            int length = 0;
+            while (length < LZ_MAX_MATCH && i + length < input_size && input[i + length] == input[i + length - offset]) {
+                length++;
+            }
+            if (length > best_length) {
+                best_length = length;
+                best_offset = offset;
+            }
+        }
+
+        if (best_length >= LZ_MIN_MATCH) {
+            output[output_size++] = 0x80 | ((best_length - LZ_MIN_MATCH) << 4) | (best_offset - 1);
+            literal_token = -1;
+            i += best_length;
+            continue;
+        }
+
+        if (literal_token == -1 || output[literal_token] == LZ_MAX_LITERALS - 1) {
+            literal_token = output_size;
+            output[output_size++] = 0;
+        }
+        else {
+            output[literal_token]++;
+        }
+        output[output_size++] = input[i++];
+    }
+
+    return output_size;
+}
+
+
+/**
+ * @brief Decompress bytes compressed by lz_compress.
+ * 
+ * @param input The compressed bytes.
+ * @param input_size The number of compressed bytes.
+ * @param output Set to the decompressed bytes.
+ * @param output_size The room in the output.
+ * @return The number of decompressed bytes. It returns -1 if the compressed bytes are corrupt.
+ */
+int lz_decompress(unsigned char *input, int input_size, unsigned char *output, int output_size) {
+    int decompressed_size = 0;
+    int i = 0;
+
+    while (i < input_size) {
+        int token = input[i++];
+
+        if (token < 0x80) {
+            int no_of_literals = token + 1;
+            if (i + no_of_literals > input_size || decompressed_size + no_of_literals > output_size) {
+                return -1;
+            }
+            memcpy(&output[decompressed_size], &input[i], no_of_literals);
+            decompressed_size += no_of_literals;
+            i += no_of_literals;
+            continue;
+        }
+
+        int length = ((token >> 4) & 7) + LZ_MIN_MATCH;
+        int offset = (token & 0xF) + 1;
+        if (offset > decompressed_size || decompressed_size + length > output_size) {
+            return -1;
+        }
+        for (int j = 0; j < length; j++) {
+            output[decompressed_size] = output[decompressed_size - offset];
+            decompressed_size++;
+        }
+    }
+
+    return decompressed_size;
+}
+
+
+// --- LOAD/STORE ---
+
+
+/**
+ * @brief Load bytes from the memory of a process into a buffer.
+ * 
+ * @param process The process whose memory is read.
+ * @param logical_address The logical address of the first byte.
+ * @param buffer Set to the bytes loaded.
+ * @param length The number of bytes to load.
+ * @return The number of bytes loaded. It returns -1 if a page fault couldn't be handled.
+ */
+int load_memory(struct PCB *process, int logical_address, unsigned char *buffer, int length) {
+    int no_of_bytes = copy_memory(process, logical_address, buffer, length, false);
+    if (no_of_bytes != -1) {
+        no_of_bytes_loaded += no_of_bytes;
+    }
+    return no_of_bytes;
+}
+
+
+/**
+ * @brief Store bytes from a buffer into the memory of a process.
+ * 
+ * @param process The process whose memory is written.
+ * @param logical_address The logical address of the first byte.
+ * @param buffer The bytes to store.
+ * @param length The number of bytes to store.
+ * @return The number of bytes stored. It returns -1 if a page fault couldn't be handled.
+ */
+int store_memory(struct PCB *process, int logical_address, unsigned char *buffer, int length) {
+    int no_of_bytes = copy_memory(process, logical_address, buffer, length, true);
+    if (no_of_bytes != -1) {
+        no_of_bytes_stored += no_of_bytes;
+    }
+    return no_of_bytes;
+}
+
+
+/**
+ * @brief Copy bytes between a buffer and the memory of a process. Every page the bytes span is accessed through the MMU, which handles its faults and sets its accessed and dirty bits. Pages that translate to consecutive frames form a physically contiguous run, and each run is copied with a single memcpy. A pending run is copied before an access that will fault, since the fault could evict one of the run's frames.
+ * 
+ * @param process The process whose memory is accessed.
+ * @param logical_address The logical address of the first byte.
+ * @param buffer The bytes to store, or set to the bytes loaded.
+ * @param length The number of bytes to copy.
+ * @param is_write Indicates whether the bytes are stored (true) or loaded (false).
+ * @return The number of bytes copied. It returns -1 if the bytes aren't all in virtual memory, or if a page fault couldn't be handled.
+ */
+int copy_memory(struct PCB *process, int logical_address, unsigned char *buffer, int length, bool is_write) {
+    if (logical_address < 0 || length < 0 || logical_address + length > VIRTUAL_MEMORY_SIZE) {
+        return -1;
+    }
+
+    int run_physical_address = -1, run_length = 0, run_buffer_offset = 0;
+    int no_of_bytes_copied = 0;
+
+    while (no_of_bytes_copied < length) {
+        int address = logical_address + no_of_bytes_copied;
+        int no_of_bytes = PAGE_SIZE - address % PAGE_SIZE;
+        if (no_of_bytes > length - no_of_bytes_copied) {
+            no_of_bytes = length - no_of_bytes_copied;
+        }
+
+        struct page_table_entry *pte = get_page_table_entry(process, address / PAGE_SIZE);
+        if (run_length > 0 && (pte->valid == 0 || (is_write && pte->writable == 0))) {
+            copy_physical_run(run_physical_address, buffer + run_buffer_offset, run_length, is_write);
+            run_length = 0;
+        }
+
+        int physical_address = access_memory(process, address, is_write);
+        if (physical_address == -1) {
+            return -1;
+        }
+
+        if (run_length > 0 && physical_address != run_physical_address + run_length) {
+            copy_physical_run(run_physical_address, buffer + run_buffer_offset, run_length, is_write);
+            run_length = 0;
+        }
+        if (run_length == 0) {
+            run_physical_address = physical_address;
+            run_buffer_offset = no_of_bytes_copied;
+        }
+        run_length += no_of_bytes;
+        no_of_bytes_copied += no_of_bytes;
+    }
+
+    if (run_length > 0) {
+        copy_physical_run(run_physical_address, buffer + run_buffer_offset, run_length, is_write);
+    }
+
+    return no_of_bytes_copied;
+}
+
+
+/**
+ * @brief Copy a physically contiguous run of bytes between a buffer and physical memory, with a single memcpy.
+ * 
+ * @param physical_address The physical address of the run.
+ * @param buffer The bytes to store, or set to the bytes loaded.
+ * @param length The length of the run in bytes.
+ * @param is_write Indicates whether the bytes are stored (true) or loaded (false).
+ */
+void copy_physical_run(int physical_address, unsigned char *buffer, int length, bool is_write) {
+    unsigned char *memory = (unsigned char *)frame_contents;
+
+    if (is_write) {
+        memcpy(memory + physical_address, buffer, length);
+    }
+    else {
+        memcpy(buffer, memory + physical_address, length);
+    }
+    no_of_physical_runs_copied++;
+}
+
+
+// --- CROSS-PROCESS COPY ---
+
+
+/**
+ * @brief Copy bytes from buffers in the memory of one process to buffers in the memory of another (like process_vm_readv and process_vm_writev). The source buffers are read in order, and fill the destination buffers in order, until either side runs out. Both sides are translated a page at a time through the MMU, faulting as needed, and each page only once unless it's evicted in the meantime. Chunks that continue the current run in both physical memories extend it, and each run is copied with a single memcpy. A pending run is copied before an access that will fault, since the fault could evict one of the run's frames.
+ * 
+ * @param destination The process copied into.
+ * @param destination_vectors The buffers copied into.
+ * @param no_of_destination_vectors The number of buffers copied into.
+ * @param source The process copied from.
+ * @param source_vectors The buffers copied from.
+ * @param no_of_source_vectors The number of buffers copied from.
+ * @return The number of bytes copied. It returns -1 if a buffer isn't in virtual memory, or a page fault couldn't be handled, before any byte was copied.
+ */
+int copy_process_memory(struct PCB *destination, struct memory_vector *destination_vectors, int no_of_destination_vectors, struct PCB *source, struct memory_vector *source_vectors, int no_of_source_vectors) {
+    for (int i = 0; i < no_of_destination_vectors; i++) {
+        if (destination_vectors[i].logical_address < 0 || destination_vectors[i].length < 0 || destination_vectors[i].logical_address + destination_vectors[i].length > VIRTUAL_MEMORY_SIZE) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < no_of_source_vectors; i++) {
+        if (source_vectors[i].logical_address < 0 || source_vectors[i].length < 0 || source_vectors[i].logical_address + source_vectors[i].length > VIRTUAL_MEMORY_SIZE) {
+            return -1;
+        }
+    }
+
+    unsigned char *memory = (unsigned char *)frame_contents;
+    long copy_cost = get_process_copy_cost();
+    int destination_vector = 0, destination_offset = 0;
+    int source_vector = 0, source_offset = 0;
+    int run_destination_address = -1, run_source_address = -1, run_length = 0;
+    int destination_page_number = -1, destination_page_address = -1, destination_evictions = -1;
+    int source_page_number = -1, source_page_address = -1, source_evictions = -1;
+    int no_of_bytes_copied = 0;
+    bool is_fault_unhandled = false;
+
+    no_of_process_copies++;
+
+    while (destination_vector < no_of_destination_vectors && source_vector < no_of_source_vectors) {
+        if (destination_offset == destination_vectors[destination_vector].length) {
+            destination_vector++;
+            destination_offset = 0;
+            continue;
+        }
+        if (source_offset == source_vectors[source_vector].length) {
+            source_vector++;
+            source_offset = 0;
+            continue;
+        }
+
+        // A chunk ends at the end of a page or a buffer, on either side
+        int destination_address = destination_vectors[destination_vector].logical_address + destination_offset;
+        int source_address = source_vectors[source_vector].logical_address + source_offset;
+        int no_of_bytes = PAGE_SIZE - destination_address % PAGE_SIZE;
+        if (no_of_bytes > PAGE_SIZE - source_address % PAGE_SIZE) {
+            no_of_bytes = PAGE_SIZE - source_address % PAGE_SIZE;
+        }
+        if (no_of_bytes > destination_vectors[destination_vector].length - destination_offset) {
+            no_of_bytes = destination_vectors[destination_vector].length - destination_offset;
+        }
+        if (no_of_bytes > source_vectors[source_vector].length - source_offset) {
+            no_of_bytes = source_vectors[source_vector].length - source_offset;
+        }
+
+        if (run_length > 0 && (will_access_fault(destination, destination_address, true) || will_access_fault(source, source_address, false))) {
+            memmove(memory + run_destination_address, memory + run_source_address, run_length);
+            no_of_process_copy_runs++;
+            run_length = 0;
+        }
+
+        // Each side's page is translated once, by the first chunk in it, unless a page has been evicted since
+        if (source_address / PAGE_SIZE != source_page_number || source_evictions != no_of_evictions) {
+            int physical_address = access_memory(source, source_address, false);
+            no_of_process_copy_pages_translated++;
+            if (physical_address == -1) {
+                is_fault_unhandled = true;
+                break;
+            }
+            source_page_number = source_address / PAGE_SIZE;
+            source_page_address = physical_address - source_address % PAGE_SIZE;
+            source_evictions = no_of_evictions;
+        }
+        if (destination_address / PAGE_SIZE != destination_page_number || destination_evictions != no_of_evictions) {
+            int physical_address = access_memory(destination, destination_address, true);
+            no_of_process_copy_pages_translated++;
+            if (physical_address == -1) {
+                is_fault_unhandled = true;
+                break;
+            }
+            destination_page_number = destination_address / PAGE_SIZE;
+            destination_page_address = physical_address - destination_address % PAGE_SIZE;
+            destination_evictions = no_of_evictions;
+        }
+        // Faulting in the destination page may have evicted the source page, and faulting that back in may evict the destination page in turn
+        if (will_access_fault(source, source_address, false)) {
+            int physical_address = access_memory(source, source_address, false);
+            no_of_process_copy_pages_translated++;
+            if (physical_address == -1 || will_access_fault(destination, destination_address, true)) {
+                is_fault_unhandled = true;
+                break;
+            }
+            source_page_address = physical_address - source_address % PAGE_SIZE;
+            source_evictions = no_of_evictions;
+        }
+        int source_physical_address = source_page_address + source_address % PAGE_SIZE;
+        int destination_physical_address = destination_page_address + destination_address % PAGE_SIZE;
+
+        if (run_length > 0 && (destination_physical_address != run_destination_address + run_length || source_physical_address != run_source_address + run_length)) {
+            memmove(memory + run_destination_address, memory + run_source_address, run_length);
+            no_of_process_copy_runs++;
+            run_length = 0;
+        }
+        if (run_length == 0) {
+            run_destination_address = destination_physical_address;
+            run_source_address = source_physical_address;
+        }
+        run_length += no_of_bytes;
+
+        destination_offset += no_of_bytes;
+        source_offset += no_of_bytes;
+        no_of_bytes_copied += no_of_bytes;
+    }
+
+    if (run_length > 0) {
+        memmove(memory + run_destination_address, memory + run_source_address, run_length);
+        no_of_process_copy_runs++;
+    }
+    no_of_bytes_copied_between_processes += no_of_bytes_copied;
+    charge_cycles(COST_PROCESS_COPY, get_process_copy_cost() - copy_cost);
+
+    if (is_fault_unhandled && no_of_bytes_copied == 0) {
+        return -1;
+    }
+    return no_of_bytes_copied;
+}
+
+
+/**
+ * @brief Check whether an access will fault: the page isn't mapped, or it's written and isn't writable.
+ * 
+ * @param process The process making the access.
+ * @param logical_address The logical address accessed.
+ * @param is_write Indicates whether the access is a write.
+ * @return true if the access will fault and false if otherwise.
+ */
+bool will_access_fault(struct PCB *process, int logical_address, bool is_write) {
+    struct page_table_entry *pte = get_page_table_entry(process, logical_address / PAGE_SIZE);
+    return pte->valid == 0 || (is_write && pte->writable == 0);
+}
+
+
+/**
+ * @brief Copy a message out of the memory of a random other process into the memory of a process, as its workload. The message is gathered from two buffers in the other process, and scattered to a single buffer.
+ * 
+ * @param process The process receiving the message.
+ * @param num_of_processes The number of processes in the workload.
+ */
+void copy_message(struct PCB *process, int num_of_processes) {
+    struct PCB *source = processes[rand() % num_of_processes];
+    if (is_process_exited[source->id] == 1) {
+        return;
+    }
+    int no_of_bytes = get_process_page_count(process) * PAGE_SIZE;
+    int no_of_source_bytes = get_process_page_count(source) * PAGE_SIZE;
+    if (source == process || no_of_bytes == 0 || no_of_source_bytes < 2) {
+        return;
+    }
+
+    if (no_of_bytes > no_of_source_bytes) {
+        no_of_bytes = no_of_source_bytes;
+    }
+    int message_length = 1 + rand() % no_of_bytes;
+    int first_length = message_length / 2;
+
+    struct memory_vector source_vectors[2] = {
+        {source->start_page_number * PAGE_SIZE, first_length},
+        {source->start_page_number * PAGE_SIZE + no_of_source_bytes - (message_length - first_length), message_length - first_length}
+    };
+    struct memory_vector destination_vector = {process->start_page_number * PAGE_SIZE, message_length};
+
+    copy_process_memory(process, &destination_vector, 1, source, source_vectors, 2);
+}
+
+
+// --- SCATTER-GATHER TRANSLATION ---
+
+
+/**
+ * @brief Translate a range of logical addresses of a process into extents of physical memory. Adjacent extents that are contiguous in physical memory are merged. The page tables are walked once over the range: each outer page table entry is read once, a huge page takes no more than its outer page table entry, and each small page takes its inner page table entry. The cost grows with the number of pages rather than the number of bytes, and is well under a full page walk per page. Like get_user_pages_fast, it doesn't fault: it stops at the first page that isn't mapped, and the caller faults the page in and translates the rest.
+ * 
+ * @param process The process whose addresses are translated.
+ * @param logical_address The first logical address.
+ * @param length The length of the range in bytes.
+ * @param extents Filled with the extents.
+ * @param max_extents The number of extents there is room for. The translation stops when they're all used.
+ * @param no_of_bytes_translated Set to the number of bytes the extents cover.
+ * @return The number of extents.
+ */
+int translate_range(struct PCB *process, int logical_address, int length, struct physical_extent *extents, int max_extents, int *no_of_bytes_translated) {
+    int no_of_extents = 0;
+    int address = logical_address;
+    int inner_page_table_no = -1; // the inner page table last read, whose outer page table entry needn't be read again
+    *no_of_bytes_translated = 0;
+
+    while (*no_of_bytes_translated < length) {
+        int page_number = address / PAGE_SIZE;
+        int physical_address, no_of_bytes;
+
+        if (page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE != inner_page_table_no) {
+            inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+            no_of_range_translation_references++; // the outer page table entry
+        }
+
+        if (process->huge_pages[inner_page_table_no] == 1) {
+            int first_page_number = inner_page_table_no * PAGES_PER_HUGE_PAGE;
+            physical_address = (process->inner_page_tables[inner_page_table_no][0].frame_number + page_number - first_page_number) * PAGE_SIZE + address % PAGE_SIZE;
+            no_of_bytes = (first_page_number + PAGES_PER_HUGE_PAGE) * PAGE_SIZE - address;
+        }
+        else {
+            struct page_table_entry *pte = get_page_table_entry(process, page_number);
+            no_of_range_translation_references++;
+            if (pte->valid == 0) {
+                break;
+            }
+            physical_address = pte->frame_number * PAGE_SIZE + address % PAGE_SIZE;
+            no_of_bytes = PAGE_SIZE - address % PAGE_SIZE;
+        }
+        if (no_of_bytes > length - *no_of_bytes_translated) {
+            no_of_bytes = length - *no_of_bytes_translated;
+        }
+
+        if (no_of_extents > 0 && extents[no_of_extents - 1].physical_address + extents[no_of_extents - 1].length == physical_address) {
+            extents[no_of_extents - 1].length += no_of_bytes;
+        }
+        else if (no_of_extents < max_extents) {
+            extents[no_of_extents].physical_address = physical_address;
+            extents[no_of_extents].length = no_of_bytes;
+            no_of_extents++;
+        }
+        else {
+            break;
+        }
+
+        address += no_of_bytes;
+        *no_of_bytes_translated += no_of_bytes;
+    }
+
+    return no_of_extents;
+}
+
+
+/**
+ * @brief Do a scatter-gather I/O of all the memory a process was granted, as a driver building scatter-gather lists for a device would. The memory is translated into lists of at most MAX_SCATTER_GATHER_EXTENTS extents. When the translation stops at a page that isn't mapped, the page is faulted in (as a read, the device reading memory) and the translation goes on from there.
+ * 
+ * @param process The process whose memory is transferred.
+ */
+void run_scatter_gather_io(struct PCB *process) {
+    int no_of_pages = get_process_page_count(process);
+    if (no_of_pages == 0) {
+        return;
+    }
+
+    struct physical_extent extents[MAX_SCATTER_GATHER_EXTENTS];
+    int logical_address = process->start_page_number * PAGE_SIZE;
+    int length = no_of_pages * PAGE_SIZE;
+    int no_of_bytes_done = 0;
+
+    no_of_scatter_gather_ios++;
+
+    while (no_of_bytes_done < length) {
+        int no_of_bytes_translated;
+        int no_of_extents = translate_range(process, logical_address + no_of_bytes_done, length - no_of_bytes_done, extents, MAX_SCATTER_GATHER_EXTENTS, &no_of_bytes_translated);
+
+        if (no_of_extents > 0) {
+            no_of_scatter_gather_lists++;
+            no_of_scatter_gather_extents += no_of_extents;
+            no_of_bytes_done += no_of_bytes_translated;
+        }
+
+        if (no_of_bytes_done < length && get_page_table_entry(process, (logical_address + no_of_bytes_done) / PAGE_SIZE)->valid == 0) {
+            no_of_range_translation_faults++;
+            if (access_memory(process, logical_address + no_of_bytes_done, false) == -1) {
+                return;
+            }
+        }
+    }
+
+    no_of_scatter_gather_pages += no_of_pages;
+}
+
+
+
+/**
+ * @brief Calculate the cycles spent copying between the memory of processes so far.
+ * 
+ * @return The cost in cycles.
+ */
+long get_process_copy_cost() {
+    return (long)no_of_process_copy_pages_translated * PROCESS_COPY_COST_PER_PAGE + (long)no_of_process_copy_runs * PROCESS_COPY_COST_PER_RUN
+    + no_of_bytes_copied_between_processes * PROCESS_COPY_COST_PER_BYTE;
+}
+
+
+// --- ZERO-COPY REMAPPING ---
+
+
+/**
+ * @brief Move pages from one process to another without copying them. Each page's frame is unmapped from the source and mapped into the destination, which updates the page table entries, the reverse map and the other page table structures. A private frame just changes owner, and stays writable and dirty. A frame that is shared (copy-on-write, merged or the zero frame) keeps its reference count: the destination maps it read-only in place of the source. Pages that aren't resident are faulted in first, huge pages are split, and shared memory pages, which the source can't give away, are copied instead. The source's TLB entries are shot down once for the whole range.
+ * 
+ * @param source The process the pages are taken from.
+ * @param source_page_number The first page taken from the source.
+ * @param destination The process the pages are given to.
+ * @param destination_page_number The first page they're mapped at in the destination. Pages mapped there are unmapped first.
+ * @param no_of_pages The number of pages.
+ * @return The number of pages remapped. It can be fewer than asked for if a page fault couldn't be handled or a destination page is shared memory.
+ */
+int remap_pages(struct PCB *source, int source_page_number, struct PCB *destination, int destination_page_number, int no_of_pages) {
+    int no_of_pages_done = 0;
+
+    no_of_remaps++;
+
+    for (; no_of_pages_done < no_of_pages; no_of_pages_done++) {
+        int page_number = source_page_number + no_of_pages_done;
+        int new_page_number = destination_page_number + no_of_pages_done;
+        if (get_shared_memory_segment(destination, new_page_number) != -1) {
+            break;
+        }
+
+        struct page_table_entry *pte = get_page_table_entry(source, page_number);
+        if (pte->valid == 0 && access_memory(source, page_number * PAGE_SIZE, false) == -1) {
+            break;
+        }
+        if (source->huge_pages[page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE] == 1) {
+            split_huge_page(source, page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE);
+        }
+        unmap_page(destination, new_page_number);
+
+        int frame_number = pte->frame_number;
+        if (get_shared_memory_segment(source, page_number) != -1) {
+            int new_frame_number = allocate_frame(destination);
+            if (new_frame_number == -1) {
+                break;
+            }
+            copy_frame(new_frame_number, frame_number);
+            for (int j = 0; j < FRAME_SIZE; j++) {
+                physical_memory[new_frame_number][j] = *destination;
+            }
+            set_page_table_entry(destination, new_page_number, new_frame_number);
+            no_of_pages_copied_by_remaps++;
+            continue;
+        }
+
+        bool is_shared = frame_number == zero_frame_number || is_ksm_frame[frame_number] == 1 || frame_reference_counts[frame_number] > 1;
+        int dirty = pte->dirty;
+
+        // The destination's reference is taken before the source's is dropped, so the frame is never free in between
+        share_frame(frame_number);
+        set_page_table_entry(destination, new_page_number, frame_number);
+        release_frame(frame_number);
+        set_page_table_entry(source, page_number, -1);
+
+        if (is_shared) {
+            write_protect_page(destination, new_page_number);
+            no_of_shared_pages_remapped++;
+        }
+        else {
+            for (int j = 0; j < FRAME_SIZE; j++) {
+                physical_memory[frame_number][j] = *destination;
+            }
+            get_page_table_entry(destination, new_page_number)->dirty = dirty;
+        }
+        no_of_pages_remapped++;
+        charge_cycles(COST_PROCESS_COPY, REMAP_COST_PER_PAGE);
+    }
+
+    tlb_shootdown(source->id, source_page_number, no_of_pages);
+
+    return no_of_pages_done;
+}
+
+
+/**
+ * @brief Pass a message of a random size from a random other process to a process, both by copying and by remapping, and compare the cycles charged for each, faults, huge page splits and shootdowns included. The sender first writes the message (its first pages) into a buffer of free pages, so that the remap gives the buffer away rather than the sender's own memory. The buffer is copied into the receiver's own memory, and then remapped to free pages of the receiver, which reads the message and unmaps it. Whatever is left of the buffer is unmapped from the sender.
+ * 
+ * @param process The process receiving the message.
+ * @param num_of_processes The number of processes in the workload.
+ */
+void pass_message(struct PCB *process, int num_of_processes) {
+    struct PCB *source = processes[rand() % num_of_processes];
+    if (is_process_exited[source->id] == 1) {
+        return;
+    }
+    int message_size = rand() % NO_OF_MESSAGE_SIZES;
+    int no_of_pages = 1 << message_size;
+    if (source == process || get_process_page_count(source) < no_of_pages || get_process_page_count(process) < no_of_pages) {
+        return;
+    }
+
+    int destination_page_number = find_free_virtual_pages(process, no_of_pages, 1);
+    int buffer_page_number = find_free_virtual_pages(source, no_of_pages, 1);
+    if (destination_page_number == -1 || buffer_page_number == -1) {
+        return;
+    }
+
+    unsigned char message[(1 << (NO_OF_MESSAGE_SIZES - 1)) * PAGE_SIZE];
+    int length = no_of_pages * PAGE_SIZE;
+    if (load_memory(source, source->start_page_number * PAGE_SIZE, message, length) != length || store_memory(source, buffer_page_number * PAGE_SIZE, message, length) != length) {
+        for (int i = 0; i < no_of_pages; i++) {
+            unmap_page(source, buffer_page_number + i);
+        }
+        return;
+    }
+
+    struct memory_vector source_vector = {buffer_page_number * PAGE_SIZE, length};
+    struct memory_vector destination_vector = {process->start_page_number * PAGE_SIZE, length};
+    long copy_cost = get_total_cycles();
+    bool is_copied = copy_process_memory(process, &destination_vector, 1, source, &source_vector, 1) == length;
+    copy_cost = get_total_cycles() - copy_cost;
+
+    int no_of_pages_remapped = 0;
+    if (is_copied) {
+        long remap_cost = get_total_cycles();
+        no_of_pages_remapped = remap_pages(source, buffer_page_number, process, destination_page_number, no_of_pages);
+        remap_cost = get_total_cycles() - remap_cost;
+
+        if (no_of_pages_remapped == no_of_pages) {
+            no_of_messages[message_size]++;
+            message_copy_cost[message_size] += copy_cost;
+            message_remap_cost[message_size] += remap_cost;
+            load_memory(process, destination_page_number * PAGE_SIZE, message, length);
+        }
+    }
+
+    for (int i = 0; i < no_of_pages_remapped; i++) {
+        unmap_page(process, destination_page_number + i);
+    }
+    for (int i = no_of_pages_remapped; i < no_of_pages; i++) {
+        unmap_page(source, buffer_page_number + i);
+    }
+}
+
+
+// --- FAULT-AROUND AND READAHEAD ---
+
+
+/**
+ * @brief Swap in the neighbours of a page that was just swapped in, in its inner page table, whose data is still in memory: in the pool or in the swap write batch. They're loaded without a swap file read, so mapping them together saves a fault on each of them later. Only free frames are used, so no page is evicted to make room for them.
+ * 
+ * @param process The process that caused the page fault.
+ * @param page_number The page that was swapped in.
+ */
+void fault_around(struct PCB *process, int page_number) {
+    int first_page_number = page_number - page_number % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+
+    for (int i = first_page_number; i < first_page_number + NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE; i++) {
+        int swap_slot = get_page_table_entry(process, i)->swap_slot;
+        if (swap_slot == -1 || !is_swapped_page_in_memory(swap_slot)) {
+            continue;
+        }
+
+        int frame_number = allocate_free_frame(process);
+        if (frame_number == -1) {
+            return;
+        }
+        load_swapped_page(process, i, frame_number);
+        is_faulted_around[process->id][i] = 1;
+        no_of_pages_faulted_around++;
+    }
+}
+
+
+/**
+ * @brief Swap in the pages after a page that was just swapped in, if the process' swap-in faults look sequential. A fault is sequential if it's on the page after the last fault, or on the page right after the last readahead window (the pages in between having been read ahead). The window starts at READAHEAD_INITIAL_WINDOW pages and doubles with each sequential fault, up to READAHEAD_MAX_WINDOW. A random fault closes it. Pages are evicted to make room for the window like for any other page, but never the faulting page.
+ * 
+ * @param process The process that caused the page fault.
+ * @param page_number The page that was swapped in.
+ */
+void read_ahead(struct PCB *process, int page_number) {
+    int *window = &readahead_windows[process->id];
+    bool is_sequential = page_number == last_swap_in_faults[process->id] + 1 || page_number == readahead_next_pages[process->id];
+
+    last_swap_in_faults[process->id] = page_number;
+    if (!is_sequential || READAHEAD_MAX_WINDOW == 0) {
+        *window = 0;
+        return;
+    }
+
+    *window = *window == 0 ? READAHEAD_INITIAL_WINDOW : *window * 2;
+    if (*window > READAHEAD_MAX_WINDOW) {
+        *window = READAHEAD_MAX_WINDOW;
+    }
+    readahead_next_pages[process->id] = page_number + *window + 1;
+
+    for (int i = page_number + 1; i <= page_number + *window && i < NO_OF_PAGES; i++) {
+        if (get_page_table_entry(process, i)->swap_slot == -1) {
+            continue;
+        }
+
+        int frame_number = allocate_frame(process);
+        if (frame_number == -1) {
+            return;
+        }
+        load_swapped_page(process, i, frame_number);
+        is_read_ahead[process->id][i] = 1;
+        no_of_pages_read_ahead++;
+    }
+}
+
+
+// --- ASYNCHRONOUS FAULTS ---
+
+
+/**
+ * @brief Hand the swap file reads of a process' workload step to the I/O workers. Each read goes to the worker that is free first, so reads ahead of a fault overlap with it.
+ * 
+ * @param no_of_reads The number of pages read.
+ * @return When the last read completes.
+ */
+long submit_swap_file_reads(int no_of_reads) {
+    long completion_time = simulated_time;
+
+    for (int i = 0; i < no_of_reads; i++) {
+        int worker = 0;
+        for (int j = 1; j < NO_OF_IO_WORKERS; j++) {
+            if (io_worker_free_times[j] < io_worker_free_times[worker]) {
+                worker = j;
+            }
+        }
+
+        long start_time = io_worker_free_times[worker] > simulated_time ? io_worker_free_times[worker] : simulated_time;
+        io_worker_free_times[worker] = start_time + SWAP_FILE_READ_TIME;
+        io_worker_busy_time += SWAP_FILE_READ_TIME;
+        if (io_worker_free_times[worker] > completion_time) {
+            completion_time = io_worker_free_times[worker];
+        }
+    }
+
+    no_of_major_faults++;
+    return completion_time;
+}
+
+
+// --- DISCRETE-EVENT SIMULATION ---
+
+
+/**
+ * @brief Empty the event queue and the ready queue, and leave every CPU idle. Every event is put on the free list.
+ */
+void initialize_event_queue() {
+    for (int i = 0; i < NO_OF_EVENT_BUCKETS; i++) {
+        event_buckets[i] = -1;
+    }
+    for (int i = 0; i < MAX_PENDING_EVENTS; i++) {
+        events[i].next = i + 1 < MAX_PENDING_EVENTS ? i + 1 : -1;
+    }
+    free_event_head = 0;
+    last_event_time = 0;
+
+    for (int i = 0; i < NO_OF_CPUS; i++) {
+        cpu_processes[i] = -1;
+    }
+    no_of_ready_processes = 0;
+}
+
+
+/**
+ * @brief Find the bucket of the radix heap an event goes in: the position of the highest bit where its time differs from the time of the last event taken, plus one. Events at that same time go in bucket 0.
+ * 
+ * @param time The time of the event.
+ * @return The bucket.
+ */
+int get_event_bucket(long time) {
+    unsigned long difference = (unsigned long)time ^ (unsigned long)last_event_time;
+    if (difference == 0) {
+        return 0;
+    }
+    return 64 - __builtin_clzl(difference);
+}
+
+
+/**
+ * @brief Post an event to the queue.
+ * 
+ * @param time When the event happens. It can't be before the last event taken.
+ * @param type The type of the event.
+ * @param id The process or CPU the event is for.
+ */
+void post_event(long time, int type, int id) {
+    if (free_event_head == -1 || time < last_event_time) {
+        printf("Event %d at %ld could not be posted\n", type, time);
+        return;
+    }
+
+    int event_index = free_event_head;
+    free_event_head = events[event_index].next;
+    events[event_index].time = time;
+    events[event_index].type = type;
+    events[event_index].id = id;
+
+    int bucket = get_event_bucket(time);
+    events[event_index].next = event_buckets[bucket];
+    event_buckets[bucket] = event_index;
+}
+
+
+/**
+ * @brief Take the earliest event from the queue. When bucket 0 is empty, the first bucket that isn't is emptied: its earliest event becomes the last event taken, and its events are spread over the lower buckets relative to that time. Every event only moves to a lower bucket, so taking an event is constant time amortized (a radix heap).
+ * 
+ * @param event Set to the event.
+ * @return true if an event was taken and false if the queue is empty.
+ */
+bool take_event(struct event *event) {
+    if (event_buckets[0] == -1) {
+        int bucket = 1;
+        while (bucket < NO_OF_EVENT_BUCKETS && event_buckets[bucket] == -1) {
+            bucket++;
+        }
+        if (bucket == NO_OF_EVENT_BUCKETS) {
+            return false;
+        }
+
+        long earliest_time = events[event_buckets[bucket]].time;
+        for (int i = event_buckets[bucket]; i != -1; i = events[i].next) {
+            if (events[i].time < earliest_time) {
+                earliest_time = events[i].time;
+            }
+        }
+        last_event_time = earliest_time;
+
+        int event_index = event_buckets[bucket];
+        event_buckets[bucket] = -1;
+        while (event_index != -1) {
+            int next_event_index = events[event_index].next;
+            int new_bucket = get_event_bucket(events[event_index].time);
+            events[event_index].next = event_buckets[new_bucket];
+            event_buckets[new_bucket] = event_index;
+            event_index = next_event_index;
+        }
+    }
+
+    int event_index = event_buckets[0];
+    *event = events[event_index];
+    event_buckets[0] = events[event_index].next;
+    events[event_index].next = free_event_head;
+    free_event_head = event_index;
+    no_of_events++;
+    return true;
+}
+
+
+/**
+ * @brief Time the event queue on its own, once the workload is over. EVENT_QUEUE_BENCHMARK_PENDING events are posted, and then the earliest event is taken and posted again a random time later, EVENT_QUEUE_BENCHMARK_EVENTS times, as the workload does with its access events. The queue is left empty, and the events taken aren't counted as the workload's.
+ */
+void measure_event_queue_rate() {
+    long no_of_workload_events = no_of_events;
+    long delays[EVENT_QUEUE_BENCHMARK_PENDING];
+    for (int i = 0; i < EVENT_QUEUE_BENCHMARK_PENDING; i++) {
+        delays[i] = 1 + rand() % TIME_QUANTUM;
+    }
+
+    initialize_event_queue();
+    for (int i = 0; i < EVENT_QUEUE_BENCHMARK_PENDING; i++) {
+        post_event(delays[i], EVENT_ACCESS, i % NO_OF_CPUS);
+    }
+
+    struct timespec start_time;
+    struct timespec end_time;
+    struct event event;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (int i = 0; i < EVENT_QUEUE_BENCHMARK_EVENTS; i++) {
+        take_event(&event);
+        post_event(event.time + delays[i % EVENT_QUEUE_BENCHMARK_PENDING], event.type, event.id);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    double seconds = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    if (seconds > 0) {
+        event_queue_rate = EVENT_QUEUE_BENCHMARK_EVENTS / seconds;
+    }
+    initialize_event_queue();
+    no_of_events = no_of_workload_events;
+}
+
+
+/**
+ * @brief Handle an event taken from the queue.
+ * 
+ * @param event The event.
+ */
+void handle_event(struct event *event) {
+    switch (event->type) {
+        case EVENT_PROCESS_ARRIVAL:
+            make_process_ready(event->id);
+            break;
+        case EVENT_READ_COMPLETION:
+            is_process_suspended[event->id] = 0;
+            make_process_ready(event->id);
+            break;
+        case EVENT_PROCESS_EXIT:
+            exit_process(event->id);
+            break;
+        case EVENT_ACCESS:
+            handle_access_event(event->id);
+            break;
+        case EVENT_DISPATCH:
+            if (cpu_processes[event->id] != -1 && (workload_accesses_left[cpu_processes[event->id]] == 0 || is_process_suspended[cpu_processes[event->id]] == 1)) {
+                cpu_processes[event->id] = -1;
+            }
+            // A process whose quantum is over keeps its CPU if no other process is ready
+            if (cpu_processes[event->id] != -1 && no_of_ready_processes == 0) {
+                cpu_quantum_ends[event->id] = simulated_time + TIME_QUANTUM;
+                post_event(simulated_time + WORKLOAD_COMPUTE_TIME, EVENT_ACCESS, event->id);
+                break;
+            }
+            if (cpu_processes[event->id] != -1) {
+                ready_queue[no_of_ready_processes++] = cpu_processes[event->id];
+                no_of_preemptions++;
+            }
+            dispatch_process(event->id);
+            break;
+        case EVENT_HUGE_PAGE_DAEMON_WAKEUP:
+            run_huge_page_daemon();
+            post_event(simulated_time + HUGE_PAGE_DAEMON_PERIOD, EVENT_HUGE_PAGE_DAEMON_WAKEUP, -1);
+            break;
+        case EVENT_KSM_WAKEUP:
+            run_ksm_scanner();
+            post_event(simulated_time + KSM_PERIOD, EVENT_KSM_WAKEUP, -1);
+            break;
+    }
+}
+
+
+/**
+ * @brief Take a process out of the workload and free its memory, so that it's no longer a source of messages or a page to scan, collapse or evict. Page table footprint and resident memory are measured when the first process exits, while every process still holds its memory.
+ * 
+ * @param process_id The id of the process.
+ */
+void exit_process(int process_id) {
+    if (no_of_live_processes == no_of_workload_processes) {
+        measure_page_table_footprint();
+        measure_resident_memory();
+    }
+
+    is_process_exited[process_id] = 1;
+    deallocate_memory(processes[process_id]);
+    no_of_live_processes--;
+}
+
+
+/**
+ * @brief Make the next access of the process running on a CPU, then decide what the CPU does next. The CPU is busy for WORKLOAD_COMPUTE_TIME plus the cycles the access was charged. If the access read from the swap file and the reads outlast that, the process is suspended until they complete and the CPU moves on to another process, or with ASYNC_FAULTS off, the CPU waits with it. A process that has made all its accesses leaves the workload, and one whose quantum is over may be preempted. A process that stops running holds on to its CPU until the CPU is free.
+ * 
+ * @param cpu The CPU.
+ */
+void handle_access_event(int cpu) {
+    int process_id = cpu_processes[cpu];
+    int no_of_swap_file_reads_before = no_of_swap_file_reads;
+    long cpu_cycles_charged_before = cpu_cycles_charged;
+
+    running_cpu = cpu;
+    run_workload_step(processes[process_id]);
+    running_cpu = -1;
+    workload_accesses_left[process_id]--;
+    cpu_busy_time += WORKLOAD_COMPUTE_TIME + cpu_cycles_charged - cpu_cycles_charged_before;
+
+    long cpu_free_time = simulated_time + cpu_cycles_charged - cpu_cycles_charged_before;
+    long resume_time = cpu_free_time;
+    if (no_of_swap_file_reads > no_of_swap_file_reads_before) {
+        long completion_time = submit_swap_file_reads(no_of_swap_file_reads - no_of_swap_file_reads_before);
+        if (completion_time > resume_time) {
+            resume_time = completion_time;
+        }
+    }
+    if (!ASYNC_FAULTS) {
+        cpu_io_wait_time += resume_time - cpu_free_time;
+        cpu_free_time = resume_time;
+    }
+
+    if (workload_accesses_left[process_id] == 0) {
+        post_event(resume_time, EVENT_PROCESS_EXIT, process_id);
+        post_event(cpu_free_time, EVENT_DISPATCH, cpu);
+    }
+    else if (resume_time > cpu_free_time) {
+        post_event(resume_time, EVENT_READ_COMPLETION, process_id);
+        is_process_suspended[process_id] = 1;
+        no_of_process_suspensions++;
+        post_event(cpu_free_time, EVENT_DISPATCH, cpu);
+    }
+    else if (cpu_free_time >= cpu_quantum_ends[cpu]) {
+        post_event(cpu_free_time, EVENT_DISPATCH, cpu);
+    }
+    else {
+        post_event(cpu_free_time + WORKLOAD_COMPUTE_TIME, EVENT_ACCESS, cpu);
+    }
+}
+
+
+/**
+ * @brief Put a process on the ready queue, and run it straight away if a CPU is idle.
+ * 
+ * @param process_id The process.
+ */
+void make_process_ready(int process_id) {
+    ready_queue[no_of_ready_processes++] = process_id;
+
+    for (int i = 0; i < NO_OF_CPUS; i++) {
+        if (cpu_processes[i] == -1) {
+            dispatch_process(i);
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Run the next ready process on a CPU for a quantum. Its first access is WORKLOAD_COMPUTE_TIME cycles later. The CPU is left idle if no process is ready.
+ * 
+ * @param cpu The CPU, whose process has stopped running.
+ */
+void dispatch_process(int cpu) {
+    int process_id = pick_next_process();
+    cpu_processes[cpu] = process_id;
+    if (process_id == -1) {
+        return;
+    }
+
+    cpu_quantum_ends[cpu] = simulated_time + TIME_QUANTUM;
+    no_of_context_switches++;
+    post_event(simulated_time + WORKLOAD_COMPUTE_TIME, EVENT_ACCESS, cpu);
+}
+
+
+/**
+ * @brief Take the process that runs next off the ready queue, according to SCHEDULER.
+ * 
+ * @return The process. It returns -1 if no process is ready.
+ */
+int pick_next_process() {
+    if (no_of_ready_processes == 0) {
+        return -1;
+    }
+
+    int position = 0;
+    if (SCHEDULER == SCHEDULER_RANDOM) {
+        position = rand() % no_of_ready_processes;
+    }
+
+    int process_id = ready_queue[position];
+    memmove(&ready_queue[position], &ready_queue[position + 1], (no_of_ready_processes - position - 1) * sizeof(int));
+    no_of_ready_processes--;
+    return process_id;
+}
+
+
+// --- CYCLE COST MODEL ---
+
+
+/**
+ * @brief Charge cycles to a cause. Cycles charged to anything but swap file reads and writes keep the CPU of the process being run busy.
+ * 
+ * @param cause The cause (COST_...).
+ * @param cycles The number of cycles.
+ */
+void charge_cycles(int cause, long cycles) {
+    cycles_by_cause[cause] += cycles;
+    if (cause != COST_SWAP_IO && cause != COST_SWAP_WRITE) {
+        cpu_cycles_charged += cycles;
+    }
+}
+
+
+/**
+ * @brief Count page walk references of the page table structure in use, and charge them.
+ * 
+ * @param no_of_references The number of page table entries read.
+ */
+void add_page_walk_references(int no_of_references) {
+    no_of_page_walk_references += no_of_references;
+    charge_cycles(COST_PAGE_WALK, (long)no_of_references * PAGE_WALK_REFERENCE_COST);
+}
+
+
+/**
+ * @brief Calculate the cycles charged to memory accesses themselves: looking up and walking for their translation, referencing their data and handling their faults, swap file reads included. The rest is charged to work around the accesses, like shootdowns, I/O, merging, copies and writing evicted pages back to the swap file.
+ * 
+ * @return The cost in cycles.
+ */
+long get_access_path_cycles() {
+    return cycles_by_cause[COST_TLB] + cycles_by_cause[COST_PAGE_WALK] + cycles_by_cause[COST_DATA] + cycles_by_cause[COST_MINOR_FAULT] + cycles_by_cause[COST_MAJOR_FAULT]
+    + cycles_by_cause[COST_SWAP_IO];
+}
+
+
+/**
+ * @brief Calculate the cycles charged so far, to every cause.
+ * 
+ * @return The cost in cycles.
+ */
+long get_total_cycles() {
+    long total_cycles = 0;
+    for (int i = 0; i < NO_OF_COST_CAUSES; i++) {
+        total_cycles += cycles_by_cause[i];
+    }
+    return total_cycles;
+}
+
+
+// --- CACHE HIERARCHY ---
+
+
+/**
+ * @brief Set up the three levels of the CPU cache hierarchy, and the fully associative LLC conflict misses are measured against, all empty. The hierarchy that measures conflict misses without page coloring is set up the same way, with every frame its own uncolored frame.
+ */
+void initialize_caches() {
+    initialize_cache(&caches[0], "L1", L1_CACHE_SIZE, L1_CACHE_ASSOCIATIVITY, L1_CACHE_HIT_COST);
+    initialize_cache(&caches[1], "L2", L2_CACHE_SIZE, L2_CACHE_ASSOCIATIVITY, L2_CACHE_HIT_COST);
+    initialize_cache(&caches[2], "LLC", LLC_SIZE, LLC_ASSOCIATIVITY, LLC_HIT_COST);
+    initialize_cache(&fully_associative_llc, "Fully Associative LLC", LLC_SIZE, LLC_SIZE / CACHE_LINE_SIZE, LLC_HIT_COST);
+
+    initialize_cache(&uncolored_caches[0], "Uncolored L1", L1_CACHE_SIZE, L1_CACHE_ASSOCIATIVITY, L1_CACHE_HIT_COST);
+    initialize_cache(&uncolored_caches[1], "Uncolored L2", L2_CACHE_SIZE, L2_CACHE_ASSOCIATIVITY, L2_CACHE_HIT_COST);
+    initialize_cache(&uncolored_caches[2], "Uncolored LLC", LLC_SIZE, LLC_ASSOCIATIVITY, LLC_HIT_COST);
+    initialize_cache(&uncolored_fully_associative_llc, "Uncolored Fully Associative LLC", LLC_SIZE, LLC_SIZE / CACHE_LINE_SIZE, LLC_HIT_COST);
+    for (int i = 0; i < NO_OF_FRAMES; i++) {
+        uncolored_frame_numbers[i] = i;
+    }
+}
+
+
+/**
+ * @brief Set up one level of the CPU cache hierarchy, with every line empty.
+ * 
+ * @param cache The cache to be set up.
+ * @param name The name of the level.
+ * @param size The size of the cache in bytes. At most LLC_SIZE.
+ * @param associativity The number of lines in a set.
+ * @param hit_cost The cycles a hit takes.
+ */
+void initialize_cache(struct cache *cache, const char *name, int size, int associativity, int hit_cost) {
+    cache->name = name;
+    cache->associativity = associativity;
+    cache->no_of_sets = size / CACHE_LINE_SIZE / associativity;
+    cache->hit_cost = hit_cost;
+    for (int i = 0; i < MAX_CACHE_LINES; i++) {
+        cache->lines[i].line_address = -1;
+        cache->lines[i].last_used = 0;
+    }
+    for (int i = 0; i < 2; i++) {
+        cache->hits[i] = 0;
+        cache->misses[i] = 0;
+    }
+}
+
+
+/**
+ * @brief Search a cache for a line. A hit makes the line the most recently used of its set.
+ * 
+ * @param cache The cache to be searched.
+ * @param line_address The line (a physical address divided by CACHE_LINE_SIZE).
+ * @return true if the line is in the cache and false if otherwise.
+ */
+bool cache_lookup(struct cache *cache, int line_address) {
+    struct cache_line *set = &cache->lines[(line_address % cache->no_of_sets) * cache->associativity];
+    for (int i = 0; i < cache->associativity; i++) {
+        if (set[i].line_address == line_address) {
+            set[i].last_used = ++cache_clock;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Insert a line into its set of a cache, as the most recently used. An empty line of the set is used if there is one. Otherwise, the least recently used line is evicted.
+ * 
+ * @param cache The cache the line is inserted into. The line must not be in it already.
+ * @param line_address The line to be inserted.
+ * @return The line that was evicted. It's -1 if none was.
+ */
+int cache_insert(struct cache *cache, int line_address) {
+    struct cache_line *set = &cache->lines[(line_address % cache->no_of_sets) * cache->associativity];
+    struct cache_line *victim = &set[0];
+    for (int i = 0; i < cache->associativity; i++) {
+        if (set[i].line_address == -1) {
+            victim = &set[i];
+            break;
+        }
+        if (set[i].last_used < victim->last_used) {
+            victim = &set[i];
+        }
+    }
+
+    int evicted_line_address = victim->line_address;
+    victim->line_address = line_address;
+    victim->last_used = ++cache_clock;
+    return evicted_line_address;
+}
+
+
+/**
+ * @brief Remove a line from a cache, if it's there.
+ * 
+ * @param cache The cache the line is removed from.
+ * @param line_address The line to be removed.
+ * @return true if the line was in the cache and false if otherwise.
+ */
+bool cache_remove(struct cache *cache, int line_address) {
+    struct cache_line *set = &cache->lines[(line_address % cache->no_of_sets) * cache->associativity];
+    for (int i = 0; i < cache->associativity; i++) {
+        if (set[i].line_address == line_address) {
+            set[i].line_address = -1;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief Reference a physical address through the cache hierarchy, and through the hierarchy that measures conflict misses without page coloring, at the address the frame first-fit allocation would have given has instead.
+ * 
+ * @param physical_address The address referenced. Page table entries have addresses past the end of physical memory.
+ * @param kind What is referenced (CACHE_REFERENCE_...).
+ * @param memory_cost The cycles the reference takes if it misses in every level.
+ * @return The cycles the reference takes.
+ */
+long access_cache_hierarchy(int physical_address, int kind, long memory_cost) {
+    int level = reference_cache_hierarchy(caches, &fully_associative_llc, no_of_llc_conflict_misses, &no_of_back_invalidations, physical_address / CACHE_LINE_SIZE, kind);
+
+    int uncolored_address = physical_address;
+    if (physical_address < PHYSICAL_MEMORY_SIZE) {
+        uncolored_address = uncolored_frame_numbers[physical_address / FRAME_SIZE] * FRAME_SIZE + physical_address % FRAME_SIZE;
+    }
+    reference_cache_hierarchy(uncolored_caches, &uncolored_fully_associative_llc, no_of_uncolored_llc_conflict_misses, &no_of_uncolored_back_invalidations, uncolored_address / CACHE_LINE_SIZE, kind);
+
+    if (level == NO_OF_CACHE_LEVELS) {
+        no_of_cache_memory_references[kind]++;
+        return memory_cost;
+    }
+    return caches[level].hit_cost;
+}
+
+
+/**
+ * @brief Reference a line through a cache hierarchy. The levels are searched in order until one hits. The fully associative LLC is fed the same lookups and fills as the LLC, and a reference that misses in the LLC but hits in it is counted as a conflict miss. On an inclusive hierarchy, the line is then filled into every level above the one that hit (all of them on a miss), and a line the LLC evicts is invalidated in L1 and L2. On an exclusive hierarchy, the line is moved up to L1 from the level that hit, and each level's evicted line moves down to the next level. The LLC's evicted line is dropped.
+ * 
+ * @param levels L1, L2 and the LLC.
+ * @param fully_associative_llc The fully associative LLC of the hierarchy.
+ * @param conflict_misses The hierarchy's conflict misses, by kind of reference.
+ * @param back_invalidations The hierarchy's back-invalidations.
+ * @param line_address The line referenced.
+ * @param kind What is referenced (CACHE_REFERENCE_...).
+ * @return The level the line hit in. It's NO_OF_CACHE_LEVELS if it missed in every level.
+ */
+int reference_cache_hierarchy(struct cache *levels, struct cache *fully_associative_llc, int *conflict_misses, int *back_invalidations, int line_address, int kind) {
+    int level = 0;
+    while (level < NO_OF_CACHE_LEVELS && !cache_lookup(&levels[level], line_address)) {
+        levels[level].misses[kind]++;
+        level++;
+    }
+    if (level < NO_OF_CACHE_LEVELS) {
+        levels[level].hits[kind]++;
+    }
+
+    bool is_in_fully_associative_llc = level >= NO_OF_CACHE_LEVELS - 1 && cache_lookup(fully_associative_llc, line_address);
+    if (is_in_fully_associative_llc && level == NO_OF_CACHE_LEVELS) {
+        conflict_misses[kind]++;
+    }
+
+    if (level == 0) {
+        return level;
+    }
+
+    if (CACHE_POLICY == CACHE_POLICY_EXCLUSIVE) {
+        // The LLC is only filled with the lines L2 evicts, and gives up the lines that hit in it
+        if (level < NO_OF_CACHE_LEVELS) {
+            cache_remove(&levels[level], line_address);
+        }
+        if (is_in_fully_associative_llc) {
+            cache_remove(fully_associative_llc, line_address);
+        }
+        int evicted_line_address = line_address;
+        for (int i = 0; i < NO_OF_CACHE_LEVELS && evicted_line_address != -1; i++) {
+            if (i == NO_OF_CACHE_LEVELS - 1 && !cache_lookup(fully_associative_llc, evicted_line_address)) {
+                cache_insert(fully_associative_llc, evicted_line_address);
+            }
+            evicted_line_address = cache_insert(&levels[i], evicted_line_address);
+        }
+        return level;
+    }
+
+    if (level == NO_OF_CACHE_LEVELS && !is_in_fully_associative_llc) {
+        cache_insert(fully_associative_llc, line_address);
+    }
+    for (int i = level - 1; i >= 0; i--) {
+        int evicted_line_address = cache_insert(&levels[i], line_address);
+        if (i == NO_OF_CACHE_LEVELS - 1 && evicted_line_address != -1) {
+            for (int j = 0; j < i; j++) {
+                if (cache_remove(&levels[j], evicted_line_address)) {
+                    (*back_invalidations)++;
+                }
+            }
+        }
+    }
+    return level;
+}
+
+
+/**
+ * @brief Find the address a page table entry would have in memory, so that references to it can go through the caches. Each process' page tables take PROCESS_PAGE_TABLE_MEMORY_SIZE bytes from PAGE_TABLE_MEMORY_BASE on: the outer page table, then the inner page tables in order. The inner page tables of shared memory segments follow those of all processes, so every process attached to a segment references the same lines.
+ * 
+ * @param process The process whose page table entry is referenced.
+ * @param page_number The page the entry translates.
+ * @param is_outer Indicates whether the outer page table entry is referenced instead of the inner one.
+ * @return The address of the entry.
+ */
+int get_page_table_entry_address(struct PCB *process, int page_number, bool is_outer) {
+    int inner_page_table_no = page_number / NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    int inner_page_table_offset = page_number % NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE;
+    int inner_page_table_size = NO_OF_PAGE_TABLE_ENTRIES_IN_PAGE * PAGE_TABLE_ENTRY_SIZE;
+    int process_page_tables = PAGE_TABLE_MEMORY_BASE + process->id * PROCESS_PAGE_TABLE_MEMORY_SIZE;
+
+    if (is_outer) {
+        return process_page_tables + inner_page_table_no * PAGE_TABLE_ENTRY_SIZE;
+    }
+
+    struct page_table_entry *shared_inner_page_table = shared_inner_page_tables[process->id][inner_page_table_no];
+    if (shared_inner_page_table != NULL) {
+        for (int i = 0; i < NO_OF_SHARED_MEMORY_SEGMENTS; i++) {
+            for (int j = 0; j < SHARED_MEMORY_INNER_PAGE_TABLES; j++) {
+                if (shared_memory_segments[i].inner_page_tables[j] == shared_inner_page_table) {
+                    return SHARED_PAGE_TABLE_MEMORY_BASE + (i * SHARED_MEMORY_INNER_PAGE_TABLES + j) * inner_page_table_size + inner_page_table_offset * PAGE_TABLE_ENTRY_SIZE;
+                }
+            }
+        }
+    }
+
+    return process_page_tables + OUTER_PAGE_TABLE_SIZE * PAGE_TABLE_ENTRY_SIZE + inner_page_table_no * inner_page_table_size + inner_page_table_offset * PAGE_TABLE_ENTRY_SIZE;
+}
+
+
+/**
+ * @brief Count a reference to a page table entry of the two-level page tables, and charge it for the cache level it hits in (PAGE_WALK_REFERENCE_COST if it misses in all of them).
+ * 
+ * @param process The process whose page table entry is read.
+ * @param page_number The page the entry translates.
+ * @param is_outer Indicates whether the outer page table entry is read instead of the inner one.
+ */
+void reference_page_table_entry(struct PCB *process, int page_number, bool is_outer) {
+    no_of_page_walk_references++;
+    int address = get_page_table_entry_address(process, page_number, is_outer);
+    charge_cycles(COST_PAGE_WALK, access_cache_hierarchy(address, CACHE_REFERENCE_PAGE_TABLE, PAGE_WALK_REFERENCE_COST));
+}
+
+
+// --- PAGE COLORING ---
+
+
+/**
+ * @brief Find the color of a frame: which LLC sets its lines map on to.
+ * 
+ * @param frame_number The frame.
+ * @return The color, from 0 to NO_OF_PAGE_COLORS - 1.
+ */
+int get_frame_color(int frame_number) {
+    return frame_number % NO_OF_PAGE_COLORS;
+}
+
+
+/**
+ * @brief Find the first free frame of a color. The frames of a color are every NO_OF_PAGE_COLORS-th frame, so they are searched with that stride.
+ * 
+ * @param color The color.
+ * @return The frame number. It returns -1 if no frame of the color is free.
+ */
+int find_free_frame_of_color(int color) {
+    for (int i = color; i < NO_OF_FRAMES; i += NO_OF_PAGE_COLORS) {
+        if (is_frame_free(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Find a free frame for a process, according to the page coloring mode. The process' colors (all of them, or its group's under partitioned coloring) are tried in turn, starting from its next color, and the color after the one found becomes its next color. Processes start at different colors. If all of them are full, any free frame is taken instead.
+ * 
+ * @param process The process the frame is for.
+ * @return The frame number. It returns -1 if no frame is free.
+ */
+int find_colored_free_frame(struct PCB *process) {
+    if (PAGE_COLORING == PAGE_COLORING_OFF) {
+        return find_free_frame_block(1, 1);
+    }
+
+    int first_color = 0;
+    int no_of_colors = NO_OF_PAGE_COLORS;
+    if (PAGE_COLORING == PAGE_COLORING_PARTITIONED) {
+        no_of_colors = NO_OF_PAGE_COLORS / PAGE_COLOR_PARTITIONS;
+        first_color = (process->id % PAGE_COLOR_PARTITIONS) * no_of_colors;
+    }
+
+    for (int i = 0; i < no_of_colors; i++) {
+        int frame_number = find_free_frame_of_color(first_color + (process->id + next_page_colors[process->id] + i) % no_of_colors);
+        if (frame_number != -1) {
+            next_page_colors[process->id] = (next_page_colors[process->id] + i + 1) % no_of_colors;
+            return frame_number;
+        }
+    }
+
+    int frame_number = find_free_frame_block(1, 1);
+    if (frame_number != -1) {
+        no_of_page_color_fallbacks++;
+    }
+    return frame_number;
+}
+
+
+/**
+ * @brief Record a frame page coloring is about to give out in place of the frame first-fit allocation would have given: of the free frames, the one with the lowest uncolored frame number. The two frames swap uncolored frame numbers, so the hierarchy without page coloring sees the first-fit frame. Without page coloring, the frame is the first-fit frame already.
+ * 
+ * @param frame_number The free frame being given out.
+ */
+void record_uncolored_frame(int frame_number) {
+    int first_fit_frame_number = frame_number;
+    for (int i = 0; i < NO_OF_FRAMES; i++) {
+        if (is_frame_free(i) && uncolored_frame_numbers[i] < uncolored_frame_numbers[first_fit_frame_number]) {
+            first_fit_frame_number = i;
+        }
+    }
+
+    int uncolored_frame_number = uncolored_frame_numbers[first_fit_frame_number];
+    uncolored_frame_numbers[first_fit_frame_number] = uncolored_frame_numbers[frame_number];
+    uncolored_frame_numbers[frame_number] = uncolored_frame_number;
+}